@@ -0,0 +1,131 @@
+/*
+ *  linux/bin/crdpack.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * crdpack minix-image crd-image
+ *
+ * Makes the compressed ram disk image rd_load() knows (see the comment
+ * in kernel/blk_drv/ramdisk.c): a crd_header, the block index and the
+ * blocks, each packed on its own. It goes on the boot floppy at block
+ * 256, where an uncompressed image would go. Runs on the build host,
+ * so everything is written little-endian by hand.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_SIZE	1024
+#define CRD_MAGIC	0x31445243	/* "CRD1" */
+#define HEAD_SIZE	12
+#define MAX_OFF		0xfff
+#define MIN_LEN		3
+#define MAX_LEN		(0xf+MIN_LEN)
+
+static void die(char * str)
+{
+	fprintf(stderr,"crdpack: %s\n",str);
+	exit(1);
+}
+
+static void put_long(unsigned char * p, unsigned long val)
+{
+	p[0] = val;
+	p[1] = val >> 8;
+	p[2] = val >> 16;
+	p[3] = val >> 24;
+}
+
+/*
+ * LZSS, the way rd_unpack() reads it. Returns the packed size, or
+ * BLOCK_SIZE if packing doesn't pay: then the block is stored as is.
+ */
+static int pack(unsigned char * buf, unsigned char * out)
+{
+	int pos = 0, len = 0, flag = 0, bit = 8;
+	int i, n, best, best_off;
+
+	while (pos < BLOCK_SIZE) {
+		if (bit == 8) {
+			if (len + 1 + 2*8 > BLOCK_SIZE-1)
+				return BLOCK_SIZE;
+			flag = len++;
+			out[flag] = 0;
+			bit = 0;
+		}
+		best = best_off = 0;
+		for (i = pos-1 ; i >= 0 && pos-i <= MAX_OFF ; i--) {
+			for (n = 0 ; n < MAX_LEN && pos+n < BLOCK_SIZE ; n++)
+				if (buf[i+n] != buf[pos+n])
+					break;
+			if (n > best) {
+				best = n;
+				best_off = pos-i;
+			}
+		}
+		if (best >= MIN_LEN) {
+			out[len++] = best_off;
+			out[len++] = ((best_off >> 4) & 0xf0) | (best-MIN_LEN);
+			pos += best;
+		} else {
+			out[flag] |= 1 << bit;
+			out[len++] = buf[pos++];
+		}
+		bit++;
+	}
+	return len;
+}
+
+int main(int argc, char ** argv)
+{
+	FILE * in, * out;
+	unsigned char buf[BLOCK_SIZE], packed[BLOCK_SIZE];
+	unsigned char * index, * data;
+	unsigned long blocks, size, used = 0;
+	int i, n;
+
+	if (argc != 3) {
+		fprintf(stderr,"usage: crdpack minix-image crd-image\n");
+		return 1;
+	}
+	if (!(in = fopen(argv[1],"rb")))
+		die("can't open the minix image");
+	if (fseek(in,0,SEEK_END) || (size = ftell(in)) == (unsigned long) -1)
+		die("can't size the minix image");
+	rewind(in);
+	blocks = (size + BLOCK_SIZE-1) / BLOCK_SIZE;
+	if (!(index = malloc((blocks+1)*4)) || !(data = malloc(blocks*BLOCK_SIZE)))
+		die("out of memory");
+	for (i = 0 ; i < blocks ; i++) {
+		memset(buf,0,BLOCK_SIZE);
+		if (!fread(buf,1,BLOCK_SIZE,in))
+			die("read error");
+		put_long(index + i*4,HEAD_SIZE + (blocks+1)*4 + used);
+		for (n = 0 ; n < BLOCK_SIZE && !buf[n] ; n++)
+			/* nothing */ ;
+		if (n == BLOCK_SIZE)
+			continue;
+		if ((n = pack(buf,packed)) < BLOCK_SIZE)
+			memcpy(data+used,packed,n);
+		else
+			memcpy(data+used,buf,n = BLOCK_SIZE);
+		used += n;
+	}
+	fclose(in);
+	size = HEAD_SIZE + (blocks+1)*4 + used;
+	put_long(index + blocks*4,size);
+	put_long(buf,CRD_MAGIC);
+	put_long(buf+4,blocks);
+	put_long(buf+8,size);
+	if (!(out = fopen(argv[2],"wb")))
+		die("can't create the image");
+	if (fwrite(buf,1,HEAD_SIZE,out) != HEAD_SIZE ||
+	    fwrite(index,4,blocks+1,out) != blocks+1 ||
+	    fwrite(data,1,used,out) != used ||
+	    fclose(out))
+		die("write error");
+	fprintf(stderr,"%lu blocks packed into %lu bytes\n",blocks,size);
+	return 0;
+}
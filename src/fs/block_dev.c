@@ -5,6 +5,7 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
@@ -13,7 +14,61 @@
 
 extern int *blk_size[];
 
-int block_write(int dev, long * pos, char * buf, int count)
+/*
+ * Raw mode is O_DIRECT on the device: whole blocks starting on a block
+ * boundary (both on the device and in user memory) go straight between
+ * the disk and the user pages as multi-sector requests, see direct.c.
+ * Returns the number of bytes done, the rest goes through the cache.
+ */
+static int raw_rw(int rw, int dev, int block, int size, char * buf, int count)
+{
+	int nr;
+
+	if (((unsigned long) buf & (BLOCK_SIZE-1)) || count < BLOCK_SIZE)
+		return 0;
+	nr = count >> BLOCK_SIZE_BITS;
+	if (nr > size - block)
+		nr = size - block;
+	if (nr <= 0)
+		return 0;
+	nr = direct_io(rw,dev,NULL,NULL,block,buf,nr);
+	return (nr < 0) ? nr : nr << BLOCK_SIZE_BITS;
+}
+
+/*
+ * Whole blocks are copied a long at a time, the rest byte-wise.
+ */
+static inline void copy_from_user(char * to, char * from, int chars)
+{
+	if (chars == BLOCK_SIZE) {
+		chars = BLOCK_SIZE/4;
+		while (chars-->0) {
+			*(long *) to = get_fs_long((unsigned long *) from);
+			to += 4;
+			from += 4;
+		}
+		return;
+	}
+	while (chars-->0)
+		*(to++) = get_fs_byte(from++);
+}
+
+static inline void copy_to_user(char * to, char * from, int chars)
+{
+	if (chars == BLOCK_SIZE) {
+		chars = BLOCK_SIZE/4;
+		while (chars-->0) {
+			put_fs_long(*(long *) from,(unsigned long *) to);
+			to += 4;
+			from += 4;
+		}
+		return;
+	}
+	while (chars-->0)
+		put_fs_byte(*(from++),to++);
+}
+
+int block_write(int dev, long * pos, char * buf, int count, int flags)
 {
 	int block = *pos >> BLOCK_SIZE_BITS;
 	int offset = *pos & (BLOCK_SIZE-1);
@@ -27,6 +82,14 @@ int block_write(int dev, long * pos, char * buf, int count)
 		size = blk_size[MAJOR(dev)][MINOR(dev)];
 	else
 		size = 0x7fffffff;
+	if ((flags & O_DIRECT) && !offset) {
+		if ((written = raw_rw(WRITE,dev,block,size,buf,count)) < 0)
+			return written;
+		block += written >> BLOCK_SIZE_BITS;
+		*pos += written;
+		buf += written;
+		count -= written;
+	}
 	while (count>0) {
 		if (block >= size)
 			return written?written:-EIO;
@@ -45,15 +108,16 @@ int block_write(int dev, long * pos, char * buf, int count)
 		*pos += chars;
 		written += chars;
 		count -= chars;
-		while (chars-->0)
-			*(p++) = get_fs_byte(buf++);
+		copy_from_user(p,buf,chars);
+		buf += chars;
 		bh->b_dirt = 1;
 		brelse(bh);
 	}
 	return written;
 }
 
-int block_read(int dev, unsigned long * pos, char * buf, int count)
+int block_read(int dev, unsigned long * pos, char * buf, int count,
+	int flags)
 {
 	int block = *pos >> BLOCK_SIZE_BITS;
 	int offset = *pos & (BLOCK_SIZE-1);
@@ -67,6 +131,14 @@ int block_read(int dev, unsigned long * pos, char * buf, int count)
 		size = blk_size[MAJOR(dev)][MINOR(dev)];
 	else
 		size = 0x7fffffff;
+	if ((flags & O_DIRECT) && !offset) {
+		if ((read = raw_rw(READ,dev,block,size,buf,count)) < 0)
+			return read;
+		block += read >> BLOCK_SIZE_BITS;
+		*pos += read;
+		buf += read;
+		count -= read;
+	}
 	while (count>0) {
 		if (block >= size)
 			return read?read:-EIO;
@@ -81,8 +153,8 @@ int block_read(int dev, unsigned long * pos, char * buf, int count)
 		*pos += chars;
 		read += chars;
 		count -= chars;
-		while (chars-->0)
-			put_fs_byte(*(p++),buf++);
+		copy_to_user(buf,p,chars);
+		buf += chars;
 		brelse(bh);
 	}
 	return read;
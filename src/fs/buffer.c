@@ -20,6 +20,9 @@
 
 #include <stdarg.h>
  
+#include <errno.h>
+#include <sys/stat.h>
+
 #include <linux/config.h>
 #include <linux/sched.h>
 #include <linux/kernel.h>
@@ -46,27 +49,61 @@ int sys_sync(void)
 	int i;
 	struct buffer_head * bh;
 
+	journal_sync();
 	sync_inodes();		/* write out inodes into buffers */
 	bh = start_buffer;
 	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
 		wait_on_buffer(bh);
-		if (bh->b_dirt)
+		if (bh->b_dirt && !journal_pinned(bh))
 			ll_rw_block(WRITE,bh);
 	}
 	return 0;
 }
 
+/*
+ * There is no way to tell a data-only change from a metadata one: the
+ * write path dirties the inode only when the size or the zones change,
+ * which fdatasync has to write anyway. So the two are the same.
+ */
+int sys_fsync(unsigned int fd)
+{
+	struct file * file;
+	struct m_inode * inode;
+
+	if (fd >= NR_OPEN || !(file=current->filp[fd]) ||
+	    !(inode=file->f_inode))
+		return -EBADF;
+	if (S_ISBLK(inode->i_mode))
+		return sync_dev(inode->i_zone[0]);
+	if (inode->i_pipe || !inode->i_dev ||
+	    !(S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode)))
+		return -EINVAL;
+	if (!inode->i_op->default_file_ops->fsync)
+		return 0;		/* nothing behind it to write to */
+	return inode->i_op->default_file_ops->fsync(inode,file);
+}
+
+int sys_fdatasync(unsigned int fd)
+{
+	return sys_fsync(fd);
+}
+
 int sync_dev(int dev)
 {
 	int i;
 	struct buffer_head * bh;
+	struct super_block * sb;
 
+/* not get_super(): we may get here from read_super() through getblk() */
+	for (sb = super_block ; sb < NR_SUPER+super_block ; sb++)
+		if (sb->s_dev == dev && sb->s_journal)
+			journal_commit(sb);
 	bh = start_buffer;
 	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
 		if (bh->b_dev != dev)
 			continue;
 		wait_on_buffer(bh);
-		if (bh->b_dev == dev && bh->b_dirt)
+		if (bh->b_dev == dev && bh->b_dirt && !journal_pinned(bh))
 			ll_rw_block(WRITE,bh);
 	}
 	sync_inodes();
@@ -75,7 +112,7 @@ int sync_dev(int dev)
 		if (bh->b_dev != dev)
 			continue;
 		wait_on_buffer(bh);
-		if (bh->b_dev == dev && bh->b_dirt)
+		if (bh->b_dev == dev && bh->b_dirt && !journal_pinned(bh))
 			ll_rw_block(WRITE,bh);
 	}
 	return 0;
@@ -212,7 +249,7 @@ repeat:
 		return bh;
 	tmp = free_list;
 	do {
-		if (tmp->b_count)
+		if (tmp->b_count || journal_pinned(tmp))
 			continue;
 		if (!bh || BADNESS(tmp)<BADNESS(bh)) {
 			bh = tmp;
@@ -222,7 +259,8 @@ repeat:
 /* and repeat until we find something good */
 	} while ((tmp = tmp->b_next_free) != free_list);
 	if (!bh) {
-		sleep_on(&buffer_wait);
+		if (!journal_sync())		/* unpins what it can */
+			sleep_on(&buffer_wait);
 		goto repeat;
 	}
 	wait_on_buffer(bh);
@@ -231,7 +269,7 @@ repeat:
 	while (bh->b_dirt) {
 		sync_dev(bh->b_dev);
 		wait_on_buffer(bh);
-		if (bh->b_count)
+		if (bh->b_count || journal_pinned(bh))
 			goto repeat;
 	}
 /* NOTE!! While we slept waiting for this block, somebody else might */
@@ -243,6 +281,7 @@ repeat:
 	bh->b_count=1;
 	bh->b_dirt=0;
 	bh->b_uptodate=0;
+	bh->b_meta=0;
 	remove_from_queues(bh);
 	bh->b_dev=dev;
 	bh->b_blocknr=block;
@@ -333,7 +372,7 @@ struct buffer_head * breada(int dev,int first, ...)
 		tmp=getblk(dev,first);
 		if (tmp) {
 			if (!tmp->b_uptodate)
-				ll_rw_block(READA,bh);
+				ll_rw_block(READA,tmp);
 			tmp->b_count--;
 		}
 	}
@@ -0,0 +1,166 @@
+/*
+ *  linux/fs/direct.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * O_DIRECT: block-aligned transfers go straight between the user's pages
+ * and the disk, without a copy and without pushing everything else out
+ * of the buffer cache. The user pages are pinned and handed to the driver
+ * as they are; consecutive blocks that are also physically contiguous in
+ * memory become one request, and up to NR_DIRECT requests are in flight.
+ * The buffer heads used here are private: nothing gets hashed.
+ *
+ * A block that is in the cache anyway is copied to/from the cached copy,
+ * so that the two can't disagree (it might be dirty).
+ */
+
+#include <errno.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+
+#define NR_DIRECT	8
+
+extern int max_sectors[];
+
+/*
+ * Returns the cached copy of 'block' if there is one that has to be
+ * used. A copy nobody else holds is simply dropped when we are about to
+ * overwrite the whole block on disk (new_block() leaves one behind).
+ */
+static struct buffer_head * cache_copy(int rw, int dev, int block)
+{
+	struct buffer_head * bh;
+
+	if (!(bh = get_hash_table(dev,block)))
+		return NULL;
+	if (bh->b_uptodate && (rw == READ || bh->b_count > 1))
+		return bh;
+	bh->b_dirt = 0;
+	bh->b_uptodate = 0;
+	brelse(bh);
+	return NULL;
+}
+
+static void copy_block(int rw, struct buffer_head * bh, char * buf)
+{
+	unsigned long * p = (unsigned long *) buf;
+	int i;
+
+	if (rw == READ)
+		for (i = 0 ; i < BLOCK_SIZE/4 ; i++)
+			put_fs_long(((unsigned long *) bh->b_data)[i],p++);
+	else {
+		for (i = 0 ; i < BLOCK_SIZE/4 ; i++)
+			((unsigned long *) bh->b_data)[i] = get_fs_long(p++);
+		bh->b_dirt = 1;
+	}
+	brelse(bh);
+}
+
+/*
+ * Waits for the request on 'bh' (if any) and unpins its pages.
+ */
+static int end_direct(struct buffer_head * bh, int sectors)
+{
+	unsigned long page, end;
+
+	if (!bh->b_dev)
+		return 0;
+	cli();
+	while (bh->b_lock)
+		sleep_on(&bh->b_wait);
+	sti();
+	page = (unsigned long) bh->b_data & 0xfffff000;
+	end = (unsigned long) bh->b_data + (sectors << 9);
+	for ( ; page < end ; page += PAGE_SIZE)
+		free_page(page);
+	bh->b_dev = 0;
+	return bh->b_uptodate ? 0 : -EIO;
+}
+
+/*
+ * Moves 'nr' blocks between 'buf' and the blocks 'map' gives for 'block'
+ * on (a NULL map means the device itself). Returns the number of blocks
+ * done, or the error if there are none.
+ */
+int direct_io(int rw, int dev, struct m_inode * inode,
+	int (*map)(struct m_inode *, int), int block, char * buf, int nr)
+{
+	struct buffer_head bh[NR_DIRECT], * p, * cbh;
+	int sectors[NR_DIRECT];
+	int slot = 0, done = 0, error = 0;
+	int i, n, max, blk, next;
+	unsigned long page;
+	char * addr;
+
+	if (!(max = max_sectors[MAJOR(dev)] >> 1))
+		return -EINVAL;
+	for (i = 0 ; i < NR_DIRECT ; i++)
+		bh[i].b_dev = 0;
+	while (done < nr) {
+		addr = buf + done*BLOCK_SIZE;
+		blk = map ? map(inode,block+done) : block+done;
+		if (map && !blk) {		/* block 0 of a device is real */
+			if (rw == WRITE) {
+				error = -ENOSPC;
+				break;
+			}
+			for (i = 0 ; i < BLOCK_SIZE/4 ; i++)
+				put_fs_long(0,i + (unsigned long *) addr);
+			done++;
+			continue;
+		}
+		if (cbh = cache_copy(rw,dev,blk)) {
+			copy_block(rw,cbh,addr);
+			done++;
+			continue;
+		}
+		p = bh + slot;
+		if (error = end_direct(p,sectors[slot]))
+			break;
+		if (!(page = pin_page(addr,rw == READ))) {
+			error = -EFAULT;
+			break;
+		}
+		p->b_data = (char *) (page + ((unsigned long) addr & 0xfff));
+		p->b_dev = dev;
+		p->b_blocknr = blk;
+		p->b_count = 1;
+		p->b_wait = NULL;
+/* see how far the run goes, on disk and in memory */
+		for (n = 1 ; n < max && done+n < nr ; n++) {
+			addr += BLOCK_SIZE;
+			next = map ? map(inode,block+done+n) : block+done+n;
+			if (next != blk+n)
+				break;
+			if (cbh = cache_copy(rw,dev,next)) {
+				brelse(cbh);
+				break;
+			}
+			if ((unsigned long) addr & 0xfff)
+				continue;
+			if (!(page = pin_page(addr,rw == READ)))
+				break;
+			if (page != (unsigned long) p->b_data + n*BLOCK_SIZE) {
+				free_page(page);
+				break;
+			}
+		}
+		sectors[slot] = n<<1;
+		ll_rw_direct(rw,p,n<<1);
+		done += n;
+		slot = (slot+1) % NR_DIRECT;
+	}
+	for (i = 0 ; i < NR_DIRECT ; i++)
+		if ((n = end_direct(bh+i,sectors[i])) && !error)
+			error = n;
+	if (error == -EIO)
+		return error;
+	return done ? done : error;
+}
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <a.out.h>
+#include <spawn.h>
 
 #include <linux/fs.h>
 #include <linux/sched.h>
@@ -31,6 +32,9 @@
 
 extern int sys_exit(int exit_code);
 extern int sys_close(int fd);
+extern int sys_dup2(unsigned int oldfd, unsigned int newfd);
+extern int sys_open(const char * filename,int flag,int mode);
+extern int sys_setpgid(int pid, int pgid);
 
 /*
  * MAX_ARG_PAGES defines the number of pages allocated for arguments
@@ -49,6 +53,10 @@ int sys_uselib(const char * library)
 	if (library) {
 		if (!(inode=namei(library)))		/* get library inode */
 			return -ENOENT;
+		if (!inode->i_op || !inode->i_op->bmap) {
+			iput(inode);	/* we page it in through bmap() */
+			return -EACCES;
+		}
 	} else
 		inode = NULL;
 /* we should check filetypes (headers etc), but we don't */
@@ -227,7 +235,8 @@ int do_execve(unsigned long * eip,long tmp,char * filename,
 	envc = count(envp);
 	
 restart_interp:
-	if (!S_ISREG(inode->i_mode)) {	/* must be regular file */
+	if (!S_ISREG(inode->i_mode) ||	/* must be regular file */
+	    !inode->i_op->bmap) {	/* ... that we can page in */
 		retval = -EACCES;
 		goto exec_error2;
 	}
@@ -356,6 +365,8 @@ restart_interp:
 		if ((current->close_on_exec>>i)&1)
 			sys_close(i);
 	current->close_on_exec = 0;
+	vfork_release();
+	exit_mmap();
 	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
 	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
 	if (last_task_used_math == current)
@@ -380,3 +391,69 @@ exec_error1:
 		free_page(page[i]);
 	return(retval);
 }
+
+static void get_fs_block(void * to, void * from, int size)
+{
+	int i;
+
+	for (i = 0 ; i < size/4 ; i++)
+		((unsigned long *) to)[i] = get_fs_long(i + (unsigned long *) from);
+}
+
+static int spawn_action(struct spawn_action * act)
+{
+	int fd, error;
+
+	switch (act->sa_type) {
+		case SPAWN_CLOSE:
+			return sys_close(act->sa_fd);
+		case SPAWN_DUP2:
+			return sys_dup2(act->sa_fd,act->sa_newfd);
+		case SPAWN_OPEN:
+			if ((fd = sys_open(act->sa_path,act->sa_oflag,
+			    act->sa_mode)) < 0 || fd == act->sa_fd)
+				return fd;
+			error = sys_dup2(fd,act->sa_fd);
+			sys_close(fd);
+			return error;
+	}
+	return -EINVAL;
+}
+
+/*
+ * A spawn()ed child starts out here (see copy_process()), still on its
+ * parent's memory, which can't change under it as the parent waits for
+ * the exec. 'eip' is its copy of the system call frame: %ebx points to
+ * the arguments. If anything goes wrong it exits with 127, as it would
+ * after a fork() and a failed exec.
+ */
+void do_spawn(unsigned long * eip)
+{
+	unsigned long * buffer = (unsigned long *) eip[-7];
+	struct spawn_attr attr;
+	struct spawn_action act;
+	char * a[4];
+	int i;
+
+	get_fs_block(a,buffer,sizeof(a));
+	if (a[3]) {
+		get_fs_block(&attr,a[3],sizeof(attr));
+		if ((attr.sp_flags & SPAWN_SETPGROUP) &&
+		    sys_setpgid(0,attr.sp_pgroup) < 0)
+			sys_exit(127);
+		if (attr.sp_flags & SPAWN_SETSIGDEF)
+			for (i=0 ; i<32 ; i++)
+				if (attr.sp_sigdefault & (1<<i))
+					current->sigaction[i].sa_handler = SIG_DFL;
+		if (attr.sp_flags & SPAWN_SETSIGMASK)
+			current->blocked = attr.sp_sigmask &
+				~(1<<(SIGKILL-1)) & ~(1<<(SIGSTOP-1));
+		for (i=0 ; i<attr.sp_nr_actions ; i++) {
+			get_fs_block(&act,attr.sp_actions+i,sizeof(act));
+			if (spawn_action(&act) < 0)
+				sys_exit(127);
+		}
+	}
+	if (do_execve(eip,0,a[0],(char **) a[1],(char **) a[2]))
+		sys_exit(127);
+}
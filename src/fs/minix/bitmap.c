@@ -44,33 +44,60 @@ __asm__("cld\n" \
 	:"=c" (__res):"c" (0),"S" (addr)); \
 __res;})
 
-int free_block(int dev, int block)
+/*
+ * free_blocks() frees the nr zones in 'p' that aren't in use by anybody
+ * else, and zeroes their entries. Runs of zones in the same zmap block
+ * only dirty it once. It returns 0 if some zones were busy.
+ */
+int free_blocks(int dev, unsigned short * p, int nr)
 {
 	struct super_block * sb;
-	struct buffer_head * bh;
+	struct buffer_head * bh, * map = NULL;
+	int block, busy = 0;
 
 	if (!(sb = get_super(dev)))
 		panic("trying to free block on nonexistent device");
-	if (block < sb->s_firstdatazone || block >= sb->s_nzones)
-		panic("trying to free block not in datazone");
-	bh = get_hash_table(dev,block);
-	if (bh) {
-		if (bh->b_count > 1) {
-			brelse(bh);
-			return 0;
+	for ( ; nr-- > 0 ; p++) {
+		if (!(block = *p))
+			continue;
+		if (block < sb->s_firstdatazone || block >= sb->s_nzones)
+			panic("trying to free block not in datazone");
+		bh = get_hash_table(dev,block);
+		if (bh) {
+			if (bh->b_count > 1) {
+				brelse(bh);
+				busy = 1;
+				continue;
+			}
+			bh->b_dirt=0;
+			bh->b_uptodate=0;
+			bh->b_meta=0;
+			if (bh->b_count)
+				brelse(bh);
 		}
-		bh->b_dirt=0;
-		bh->b_uptodate=0;
-		if (bh->b_count)
-			brelse(bh);
-	}
-	block -= sb->s_firstdatazone - 1 ;
-	if (clear_bit(block&8191,sb->s_zmap[block/8192]->b_data)) {
-		printk("block (%04x:%d) ",dev,block+sb->s_firstdatazone-1);
-		printk("free_block: bit already cleared\n");
+		block -= sb->s_firstdatazone - 1 ;
+		if (map != sb->s_zmap[block/8192]) {
+			if (map)
+				map->b_dirt = 1;
+			map = sb->s_zmap[block/8192];
+		}
+		if (clear_bit(block&8191,map->b_data)) {
+			printk("block (%04x:%d) ",dev,block+sb->s_firstdatazone-1);
+			printk("free_block: bit already cleared\n");
+		} else
+			sb->s_free_zones++;
+		*p = 0;
 	}
-	sb->s_zmap[block/8192]->b_dirt = 1;
-	return 1;
+	if (map)
+		map->b_dirt = 1;
+	return !busy;
+}
+
+int free_block(int dev, int block)
+{
+	unsigned short nr = block;
+
+	return free_blocks(dev,&nr,1);
 }
 
 int new_block(int dev)
@@ -81,6 +108,8 @@ int new_block(int dev)
 
 	if (!(sb = get_super(dev)))
 		panic("trying to get new block from nonexistant device");
+	if (!sb->s_free_zones)
+		return 0;
 	j = 8192;
 	for (i=0 ; i<8 ; i++)
 		if (bh=sb->s_zmap[i])
@@ -94,6 +123,7 @@ int new_block(int dev)
 	j += i*8192 + sb->s_firstdatazone-1;
 	if (j >= sb->s_nzones)
 		return 0;
+	sb->s_free_zones--;
 	if (!(bh=getblk(dev,j)))
 		panic("new_block: cannot get block");
 	if (bh->b_count != 1)
@@ -105,6 +135,39 @@ int new_block(int dev)
 	return j;
 }
 
+/*
+ * new_blocks() allocates 'nr' contiguous zones, first fit, and returns
+ * the first one, or 0 if there is no such run. Unlike new_block() it
+ * doesn't clear them: the caller fills them in.
+ */
+int new_blocks(int dev, int nr)
+{
+	struct super_block * sb;
+	int i, j, bits, run = 0;
+
+	if (!(sb = get_super(dev)))
+		panic("trying to get new blocks from nonexistant device");
+	if (nr <= 0 || sb->s_free_zones < nr)
+		return 0;
+	bits = sb->s_nzones - sb->s_firstdatazone + 1;
+	for (i = 1 ; i < bits && sb->s_zmap[i>>13] ; i++) {
+		if (sb->s_zmap[i>>13]->b_data[(i&8191)>>3] & (1 << (i&7))) {
+			run = 0;
+			continue;
+		}
+		if (++run < nr)
+			continue;
+		for (j = i-nr+1 ; j <= i ; j++) {
+			if (set_bit(j&8191,sb->s_zmap[j>>13]->b_data))
+				panic("new_blocks: bit already set");
+			sb->s_zmap[j>>13]->b_dirt = 1;
+		}
+		sb->s_free_zones -= nr;
+		return i-nr+1 + sb->s_firstdatazone-1;
+	}
+	return 0;
+}
+
 void free_inode(struct m_inode * inode)
 {
 	struct super_block * sb;
@@ -130,6 +193,8 @@ void free_inode(struct m_inode * inode)
 		panic("nonexistent imap in superblock");
 	if (clear_bit(inode->i_num&8191,bh->b_data))
 		printk("free_inode: bit already cleared.\n\r");
+	else
+		sb->s_free_inodes++;
 	bh->b_dirt = 1;
 	memset(inode,0,sizeof(*inode));
 }
@@ -145,6 +210,10 @@ struct m_inode * new_inode(int dev)
 		return NULL;
 	if (!(sb = get_super(dev)))
 		panic("new_inode with unknown device");
+	if (!sb->s_free_inodes) {
+		iput(inode);
+		return NULL;
+	}
 	j = 8192;
 	for (i=0 ; i<8 ; i++)
 		if (bh=sb->s_imap[i])
@@ -157,9 +226,12 @@ struct m_inode * new_inode(int dev)
 	if (set_bit(j,bh->b_data))
 		panic("new_inode: bit already set");
 	bh->b_dirt = 1;
+	sb->s_free_inodes--;
 	inode->i_count=1;
 	inode->i_nlinks=1;
 	inode->i_dev=dev;
+	inode->i_sb=sb;
+	inode->i_op=&minix_inode_operations;
 	inode->i_uid=current->euid;
 	inode->i_gid=current->egid;
 	inode->i_dirt=1;
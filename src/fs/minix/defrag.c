@@ -0,0 +1,175 @@
+/*
+ *  linux/fs/minix/defrag.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * defrag.c moves the data blocks of a file into one contiguous run of
+ * free zones, while the file system stays mounted. The indirect blocks
+ * stay where they are and are just rewritten.
+ *
+ * The blocks are moved DEFRAG_BATCH at a time, each batch one journal
+ * transaction. Nobody else may have the file open when a batch starts;
+ * somebody opening it during one waits on i_defrag before truncating or
+ * writing it. The inode isn't locked: that would deadlock in getblk().
+ */
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+
+#define DEFRAG_BATCH	16
+
+#define BUSY(file,inode) ((inode)->i_count > 1 || (file)->f_count > 1)
+
+/*
+ * fragments() returns the number of contiguous pieces the first 'nr'
+ * blocks of the file are in. Holes count as breaks.
+ */
+static int fragments(struct m_inode * inode, int nr)
+{
+	int i, block, last = -1, frags = 0;
+
+	for (i = 0 ; i < nr ; i++) {
+		block = bmap(inode,i);
+		if (block && block != last+1)
+			frags++;
+		last = block ? block : -1;
+	}
+	return frags;
+}
+
+/*
+ * Point logical block 'nr' of the file at zone 'block'.
+ */
+static int set_zone(struct m_inode * inode, int nr, int block)
+{
+	struct buffer_head * bh;
+	int ind;
+
+	if (nr < 7) {
+		inode->i_zone[nr] = block;
+		return 0;
+	}
+	nr -= 7;
+	if (nr < 512)
+		ind = inode->i_zone[7];
+	else {
+		nr -= 512;
+		if (!(bh = bread(inode->i_dev,inode->i_zone[8])))
+			return -EIO;
+		ind = ((unsigned short *) bh->b_data)[nr>>9];
+		brelse(bh);
+		nr &= 511;
+	}
+	if (!ind || !(bh = bread(inode->i_dev,ind)))
+		return -EIO;
+	((unsigned short *) bh->b_data)[nr] = block;
+	bh->b_meta = bh->b_dirt = 1;
+	brelse(bh);
+	return 0;
+}
+
+static void end_batch(struct m_inode * inode)
+{
+	inode->i_defrag = 0;
+	wake_up(&inode->i_wait);
+}
+
+/*
+ * Everything is looked up again for every block: between batches the
+ * file may have been truncated or rewritten. The zones of the new run
+ * stay allocated until they are used or freed here.
+ */
+static int do_defrag(struct file * file, struct m_inode * inode,
+	struct defrag_stat * st)
+{
+	struct buffer_head * from, * to;
+	int nr, i, start, old, error = 0;
+
+	nr = (inode->i_size + BLOCK_SIZE-1) / BLOCK_SIZE;
+	st->d_blocks = nr;
+	st->d_before = st->d_after = fragments(inode,nr);
+	if (st->d_before <= 1)
+		return 0;
+	if (!(start = new_blocks(inode->i_dev,nr)))
+		return -ENOSPC;
+	for (i = 0 ; i < nr ; i++) {
+		if (!(i % DEFRAG_BATCH)) {
+			if (i) {
+				end_batch(inode);
+				journal_restart();
+			}
+			if (!error && BUSY(file,inode))
+				error = -EBUSY;
+			inode->i_defrag = 1;
+		}
+		if (error || !(old = bmap(inode,i))) {
+			free_block(inode->i_dev,start+i);
+			continue;
+		}
+		if (!(from = bread(inode->i_dev,old))) {
+			error = -EIO;
+			free_block(inode->i_dev,start+i);
+			continue;
+		}
+		to = getblk(inode->i_dev,start+i);
+		memcpy(to->b_data,from->b_data,BLOCK_SIZE);
+		to->b_uptodate = 1;
+		to->b_dirt = 1;
+		brelse(to);
+		brelse(from);
+		if (error = set_zone(inode,i,start+i)) {
+			free_block(inode->i_dev,start+i);
+			continue;
+		}
+		while (!free_block(inode->i_dev,old)) {
+			current->counter = 0;
+			schedule();
+		}
+		inode->i_dirt = 1;
+	}
+	end_batch(inode);
+	st->d_after = fragments(inode,nr);
+	return error;
+}
+
+/*
+ * defrag() relocates the file open on 'fd', and reports how many blocks
+ * it has and how many pieces they were in before and after.
+ */
+int sys_defrag(unsigned int fd, struct defrag_stat * stat)
+{
+	struct file * file;
+	struct m_inode * inode;
+	struct super_block * sb;
+	struct defrag_stat tmp;
+	int i, error;
+
+	if (fd >= NR_OPEN || !(file=current->filp[fd]) ||
+	    !(inode=file->f_inode))
+		return -EBADF;
+	if (!S_ISREG(inode->i_mode) || inode->i_op != &minix_inode_operations)
+		return -EINVAL;
+	if (!suser() && current->euid != inode->i_uid)
+		return -EPERM;
+	if (!(sb = get_super(inode->i_dev)) || sb->s_rd_only)
+		return -EROFS;
+	if (stat)
+		verify_area(stat,sizeof (struct defrag_stat));
+	if (BUSY(file,inode) || inode->i_defrag)
+		return -EBUSY;
+	journal_start();
+	error = do_defrag(file,inode,&tmp);
+	journal_stop();
+	if (!error && stat)
+		for (i=0 ; i<sizeof (tmp) ; i++)
+			put_fs_byte(((char *) &tmp)[i],i + (char *) stat);
+	return error;
+}
@@ -0,0 +1,86 @@
+/*
+ *  linux/fs/minix/dir.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/dirent.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <asm/segment.h>
+
+/*
+ * Start reading the inode-table blocks of all entries in a directory
+ * block, so the iget()s of READDIR_PLUS don't wait for them one by one.
+ */
+static void prefetch_inodes(int dev, struct dir_entry * de, int nr)
+{
+	struct super_block * sb;
+	struct buffer_head * bh;
+	int block, last = -1;
+
+	if (!(sb = get_super(dev)))
+		return;
+	for ( ; nr-- > 0 ; de++) {
+		if (!de->inode)
+			continue;
+		block = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
+			(de->inode-1)/INODES_PER_BLOCK;
+		if (block == last)
+			continue;
+		last = block;
+		if (!(bh = getblk(dev,block)))
+			continue;
+		if (!bh->b_uptodate)
+			ll_rw_block(READA,bh);
+		bh->b_count--;
+	}
+}
+
+int minix_readdir(struct m_inode * inode, struct file * filp,
+	char * buf, int count, int flags)
+{
+	struct buffer_head * bh;
+	struct dir_entry * de;
+	int block, offset, n, done = 0;
+
+	filp->f_pos &= ~(sizeof (struct dir_entry) - 1);
+	while (filp->f_pos < inode->i_size) {
+		offset = filp->f_pos % BLOCK_SIZE;
+		if (!(block = bmap(inode,filp->f_pos/BLOCK_SIZE)) ||
+		    !(bh = bread(inode->i_dev,block))) {
+			filp->f_pos += BLOCK_SIZE - offset;
+			continue;
+		}
+		de = (struct dir_entry *) (offset + bh->b_data);
+		n = (BLOCK_SIZE - offset) / sizeof (struct dir_entry);
+		if (n > (inode->i_size - filp->f_pos) / sizeof (struct dir_entry))
+			n = (inode->i_size - filp->f_pos) / sizeof (struct dir_entry);
+		if (flags & READDIR_PLUS)
+			prefetch_inodes(inode->i_dev,de,n);
+		for ( ; n-- > 0 ; de++) {
+			if (de->inode) {
+				int size = put_dirent(inode,de,
+					filp->f_pos + sizeof (struct dir_entry),
+					buf,count,flags);
+				if (size <= 0) {
+					brelse(bh);
+					if (done)
+						goto out;
+					return size ? size : -EINVAL;
+				}
+				buf += size;
+				count -= size;
+				done += size;
+			}
+			filp->f_pos += sizeof (struct dir_entry);
+		}
+		brelse(bh);
+	}
+out:
+	update_atime(inode);
+	return done;
+}
@@ -9,11 +9,23 @@
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/locks.h>
 #include <asm/segment.h>
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
+#define JOURNAL_CHUNK	64	/* blocks written per transaction */
+
+/*
+ * O_DIRECT takes the whole blocks of a transfer that starts on a block
+ * boundary in both the file and user memory; the tail goes the usual way.
+ */
+#define DIRECT(filp,pos,buf,count) (((filp)->f_flags & O_DIRECT) && \
+	!(((pos) | (unsigned long) (buf)) & (BLOCK_SIZE-1)) && \
+	(count) >= BLOCK_SIZE)
+
 int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 {
 	int left,chars,nr;
@@ -21,6 +33,17 @@ int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 
 	if ((left=count)<=0)
 		return 0;
+	if (DIRECT(filp,filp->f_pos,buf,left)) {
+		nr = direct_io(READ,inode->i_dev,inode,bmap,
+			filp->f_pos/BLOCK_SIZE,buf,left/BLOCK_SIZE);
+		if (nr < 0) {
+			update_atime(inode);
+			return nr;
+		}
+		filp->f_pos += nr*BLOCK_SIZE;
+		buf += nr*BLOCK_SIZE;
+		left -= nr*BLOCK_SIZE;
+	}
 	while (left) {
 		if (nr = bmap(inode,(filp->f_pos)/BLOCK_SIZE)) {
 			if (!(bh=bread(inode->i_dev,nr)))
@@ -41,11 +64,11 @@ int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 				put_fs_byte(0,buf++);
 		}
 	}
-	inode->i_atime = CURRENT_TIME;
+	update_atime(inode);
 	return (count-left)?(count-left):-ERROR;
 }
 
-int file_write(struct m_inode * inode, struct file * filp, char * buf, int count)
+static int do_file_write(struct m_inode * inode, struct file * filp, char * buf, int count)
 {
 	off_t pos;
 	int block,c;
@@ -61,6 +84,26 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 		pos = inode->i_size;
 	else
 		pos = filp->f_pos;
+	if (DIRECT(filp,pos,buf,count))
+		while (count-i >= BLOCK_SIZE) {
+			block = MIN((count-i)/BLOCK_SIZE,JOURNAL_CHUNK);
+			c = direct_io(WRITE,inode->i_dev,inode,create_block,
+				pos/BLOCK_SIZE,buf,block);
+			if (c < 0 && !i)
+				return c;
+			if (c <= 0)
+				break;
+			i += c*BLOCK_SIZE;
+			pos += c*BLOCK_SIZE;
+			buf += c*BLOCK_SIZE;
+			if (pos > inode->i_size) {
+				inode->i_size = pos;
+				inode->i_dirt = 1;
+			}
+			journal_restart();
+			if (c < block)
+				break;
+		}
 	while (i<count) {
 		if (!(block = create_block(inode,pos/BLOCK_SIZE)))
 			break;
@@ -80,7 +123,10 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 		while (c-->0)
 			*(p++) = get_fs_byte(buf++);
 		brelse(bh);
+		if (!(pos % (JOURNAL_CHUNK*BLOCK_SIZE)))
+			journal_restart();
 	}
+	update_vm_cache(inode,pos-i,buf-i,i);
 	inode->i_mtime = CURRENT_TIME;
 	if (!(filp->f_flags & O_APPEND)) {
 		filp->f_pos = pos;
@@ -88,3 +134,25 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 	}
 	return (i?i:-1);
 }
+
+/*
+ * The write is a journal transaction, restarted every JOURNAL_CHUNK
+ * blocks. O_SYNC waits for the blocks after that, so a journalled file
+ * system can commit the metadata too.
+ */
+int file_write(struct m_inode * inode, struct file * filp, char * buf, int count)
+{
+	struct super_block * sb;
+	off_t pos;
+	int written;
+
+	journal_start();
+	wait_on_defrag(inode);
+	pos = (filp->f_flags & O_APPEND) ? inode->i_size : filp->f_pos;
+	written = do_file_write(inode,filp,buf,count);
+	journal_stop();
+	if (written > 0 && ((filp->f_flags & O_SYNC) ||
+	    ((sb = get_super(inode->i_dev)) && (sb->s_flags & MS_SYNCHRONOUS))))
+		file_fsync(inode,pos/BLOCK_SIZE,(pos+written-1)/BLOCK_SIZE);
+	return written;
+}
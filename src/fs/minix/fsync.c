@@ -0,0 +1,96 @@
+/*
+ *  linux/fs/minix/fsync.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * fsync.c writes out the blocks of a single file. The first pass only
+ * starts the writes, the second one waits for them, so the disk gets
+ * the whole lot at once and can sort it.
+ */
+#include <linux/sched.h>
+#include <linux/kernel.h>
+
+#define SYNC_WAIT	1	/* second pass */
+
+/*
+ * Metadata the journal has pinned is left to journal_commit().
+ */
+static void sync_zone(int dev, int nr, int flags)
+{
+	struct buffer_head * bh;
+
+	if (!(bh = get_hash_table(dev,nr)))
+		return;
+	if (bh->b_dirt && !journal_pinned(bh))
+		ll_rw_block(WRITE,bh);
+	if (flags & SYNC_WAIT)
+		brelse(bh);
+	else
+		bh->b_count--;
+}
+
+/*
+ * 'nr' maps the file blocks from 'base' on, through 'depth' levels of
+ * indirect blocks. Only those between 'first' and 'last' are written,
+ * together with the indirect blocks leading to them.
+ */
+static void sync_tree(int dev, int nr, int depth, int base,
+	int first, int last, int flags)
+{
+	struct buffer_head * bh;
+	int i, span;
+
+	if (!nr)
+		return;
+	if (depth && (bh = bread(dev,nr))) {
+		span = (depth == 1) ? 1 : 512;
+		for (i = 0 ; i < 512 ; i++, base += span)
+			if (base + span > first && base <= last)
+				sync_tree(dev,((unsigned short *) bh->b_data)[i],
+					depth-1,base,first,last,flags);
+		brelse(bh);
+	}
+	sync_zone(dev,nr,flags);
+}
+
+static void sync_blocks(struct m_inode * inode, int first, int last, int flags)
+{
+	int i;
+
+	for (i = first ; i < 7 && i <= last ; i++)
+		sync_tree(inode->i_dev,inode->i_zone[i],0,i,first,last,flags);
+	if (last >= 7)
+		sync_tree(inode->i_dev,inode->i_zone[7],1,7,first,last,flags);
+	if (last >= 7+512)
+		sync_tree(inode->i_dev,inode->i_zone[8],2,7+512,first,last,flags);
+}
+
+/*
+ * Write blocks 'first' to 'last' of the file and the inode itself, and
+ * wait for it all to hit the disk. On a journalled file system the data
+ * goes first and a commit does the rest; inside a transaction that has
+ * to wait for the commit at its end.
+ */
+void file_fsync(struct m_inode * inode, int first, int last)
+{
+	struct super_block * sb;
+
+	if (first < 0)
+		first = 0;
+	if (last >= 7+512+512*512)
+		last = 7+512+512*512-1;
+	sync_blocks(inode,first,last,0);
+	sync_blocks(inode,first,last,SYNC_WAIT);
+	if ((sb = get_super(inode->i_dev)) && sb->s_journal)
+		journal_commit(sb);
+	else
+		sync_inode(inode);
+}
+
+int minix_fsync(struct m_inode * inode, struct file * filp)
+{
+	file_fsync(inode,0,7+512+512*512-1);
+	return 0;
+}
@@ -10,36 +10,20 @@
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/locks.h>
 #include <asm/system.h>
 
 extern int *blk_size[];
 
 struct m_inode inode_table[NR_INODE]={{0,},};
 
-static void read_inode(struct m_inode * inode);
-static void write_inode(struct m_inode * inode);
-
-static inline void wait_on_inode(struct m_inode * inode)
+static inline void write_inode(struct m_inode * inode)
 {
-	cli();
-	while (inode->i_lock)
-		sleep_on(&inode->i_wait);
-	sti();
-}
-
-static inline void lock_inode(struct m_inode * inode)
-{
-	cli();
-	while (inode->i_lock)
-		sleep_on(&inode->i_wait);
-	inode->i_lock=1;
-	sti();
-}
-
-static inline void unlock_inode(struct m_inode * inode)
-{
-	inode->i_lock=0;
-	wake_up(&inode->i_wait);
+	if (inode->i_sb && !inode->i_sb->s_rd_only &&
+	    inode->i_sb->s_op->write_inode)
+		inode->i_sb->s_op->write_inode(inode);
+	else
+		inode->i_dirt = 0;
 }
 
 void invalidate_inodes(int dev)
@@ -58,6 +42,10 @@ void invalidate_inodes(int dev)
 	}
 }
 
+/*
+ * write_inode() takes all dirty inodes sharing the inode-table block
+ * along with it, so this touches every block at most once.
+ */
 void sync_inodes(void)
 {
 	int i;
@@ -71,6 +59,53 @@ void sync_inodes(void)
 	}
 }
 
+/*
+ * Write the inode out and wait until it's on the disk - unless the
+ * journal has it pinned, then the next commit takes it along.
+ */
+void sync_inode(struct m_inode * inode)
+{
+	struct super_block * sb;
+	struct buffer_head * bh;
+	int block;
+
+	write_inode(inode);
+	if (!(sb=get_super(inode->i_dev)))
+		return;
+	block = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
+		(inode->i_num-1)/INODES_PER_BLOCK;
+	if (!(bh=get_hash_table(inode->i_dev,block)))
+		return;
+	if (bh->b_dirt && !journal_pinned(bh))
+		ll_rw_block(WRITE,bh);
+	brelse(bh);
+}
+
+/*
+ * Reads go through here instead of setting i_atime themselves, so the
+ * mount flags decide whether i_atime changes at all. Being read never
+ * dirties the inode, whatever the flags: i_atime is only written out
+ * along with some other change, as it always was.
+ */
+void update_atime(struct m_inode * inode)
+{
+	struct super_block * sb;
+	long now = CURRENT_TIME;
+
+	if (!(sb=get_super(inode->i_dev)) || sb->s_rd_only)
+		return;
+	if (sb->s_flags & MS_NOATIME)
+		return;
+	if ((sb->s_flags & MS_NODIRATIME) && S_ISDIR(inode->i_mode))
+		return;
+	if ((sb->s_flags & MS_RELATIME) && inode->i_atime >= inode->i_mtime &&
+	    inode->i_atime >= inode->i_ctime && now - inode->i_atime < 24*60*60)
+		return;
+	if (inode->i_atime == now)
+		return;
+	inode->i_atime = now;
+}
+
 static int _bmap(struct m_inode * inode,int block,int create)
 {
 	struct buffer_head * bh;
@@ -103,7 +138,7 @@ static int _bmap(struct m_inode * inode,int block,int create)
 		if (create && !i)
 			if (i=new_block(inode->i_dev)) {
 				((unsigned short *) (bh->b_data))[block]=i;
-				bh->b_dirt=1;
+				bh->b_meta=bh->b_dirt=1;
 			}
 		brelse(bh);
 		return i;
@@ -122,7 +157,7 @@ static int _bmap(struct m_inode * inode,int block,int create)
 	if (create && !i)
 		if (i=new_block(inode->i_dev)) {
 			((unsigned short *) (bh->b_data))[block>>9]=i;
-			bh->b_dirt=1;
+			bh->b_meta=bh->b_dirt=1;
 		}
 	brelse(bh);
 	if (!i)
@@ -133,7 +168,7 @@ static int _bmap(struct m_inode * inode,int block,int create)
 	if (create && !i)
 		if (i=new_block(inode->i_dev)) {
 			((unsigned short *) (bh->b_data))[block&511]=i;
-			bh->b_dirt=1;
+			bh->b_meta=bh->b_dirt=1;
 		}
 	brelse(bh);
 	return i;
@@ -161,10 +196,13 @@ void iput(struct m_inode * inode)
 		wake_up(&inode->i_wait2);
 		if (--inode->i_count)
 			return;
+		if (inode->i_notify)
+			notify_release(inode);
 		free_page(inode->i_size);
 		inode->i_count=0;
 		inode->i_dirt=0;
 		inode->i_pipe=0;
+		inode->i_notify=0;
 		return;
 	}
 	if (!inode->i_dev) {
@@ -181,8 +219,7 @@ repeat:
 		return;
 	}
 	if (!inode->i_nlinks) {
-		truncate(inode);
-		free_inode(inode);
+		inode->i_sb->s_op->put_inode(inode);
 		return;
 	}
 	if (inode->i_dirt) {
@@ -234,7 +271,7 @@ struct m_inode * get_pipe_inode(void)
 
 	if (!(inode = get_empty_inode()))
 		return NULL;
-	if (!(inode->i_size=get_free_page())) {
+	if (!(inode->i_size=__get_free_page())) {
 		inode->i_count = 0;
 		return NULL;
 	}
@@ -290,22 +327,35 @@ struct m_inode * iget(int dev,int nr)
 	inode=empty;
 	inode->i_dev = dev;
 	inode->i_num = nr;
-	read_inode(inode);
+	lock_inode(inode);
+	if (!(inode->i_sb = get_super(dev)))
+		panic("trying to read inode without dev");
+	inode->i_sb->s_op->read_inode(inode);
+	unlock_inode(inode);
 	return inode;
 }
 
-static void read_inode(struct m_inode * inode)
+/*
+ * Directories tend to hand out neighbouring inode numbers, so a stat()
+ * of every entry walks the inode table in order: read the next couple
+ * of inode-table blocks ahead while we're at it.
+ */
+static void minix_read_inode(struct m_inode * inode)
 {
-	struct super_block * sb;
+	struct super_block * sb = inode->i_sb;
 	struct buffer_head * bh;
-	int block;
+	int block, first, last;
 
-	lock_inode(inode);
-	if (!(sb=get_super(inode->i_dev)))
-		panic("trying to read inode without dev");
-	block = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
-		(inode->i_num-1)/INODES_PER_BLOCK;
-	if (!(bh=bread(inode->i_dev,block)))
+	first = 2 + sb->s_imap_blocks + sb->s_zmap_blocks;
+	last = first + (sb->s_ninodes-1)/INODES_PER_BLOCK;
+	block = first + (inode->i_num-1)/INODES_PER_BLOCK;
+	if (block+2 <= last)
+		bh = breada(inode->i_dev,block,block+1,block+2,-1);
+	else if (block+1 <= last)
+		bh = breada(inode->i_dev,block,block+1,-1);
+	else
+		bh = bread(inode->i_dev,block);
+	if (!bh)
 		panic("unable to read i-node block");
 	//*(struct d_inode *)inode =
 	//	((struct d_inode *)bh->b_data)
@@ -321,22 +371,29 @@ static void read_inode(struct m_inode * inode)
 		else
 			inode->i_size = 0x7fffffff;
 	}
-	unlock_inode(inode);
+	inode->i_op = &minix_inode_operations;
 }
 
-static void write_inode(struct m_inode * inode)
+/*
+ * Any other dirty inode living in the same inode-table block is written
+ * out too, as long as nobody holds it locked: we don't sleep between the
+ * bread() and brelse(), so nothing can change under us. Dirtying the
+ * block is a transaction of its own, so the journal can count it.
+ */
+static void minix_write_inode(struct m_inode * inode)
 {
-	struct super_block * sb;
+	struct super_block * sb = inode->i_sb;
 	struct buffer_head * bh;
+	struct m_inode * tmp;
 	int block;
 
+	journal_start();
 	lock_inode(inode);
 	if (!inode->i_dirt || !inode->i_dev) {
 		unlock_inode(inode);
+		journal_stop();
 		return;
 	}
-	if (!(sb=get_super(inode->i_dev)))
-		panic("trying to write inode without device");
 	block = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
 		(inode->i_num-1)/INODES_PER_BLOCK;
 	if (!(bh=bread(inode->i_dev,block)))
@@ -346,6 +403,78 @@ static void write_inode(struct m_inode * inode)
 			*(struct d_inode *)inode;
 	bh->b_dirt=1;
 	inode->i_dirt=0;
+	for (tmp = inode_table ; tmp < NR_INODE+inode_table ; tmp++) {
+		if (!tmp->i_dirt || tmp->i_lock || tmp->i_pipe ||
+		    tmp->i_dev != inode->i_dev ||
+		    (tmp->i_num-1)/INODES_PER_BLOCK !=
+		    (inode->i_num-1)/INODES_PER_BLOCK)
+			continue;
+		((struct d_inode *)bh->b_data)
+			[(tmp->i_num-1)%INODES_PER_BLOCK] =
+				*(struct d_inode *)tmp;
+		tmp->i_dirt=0;
+	}
 	brelse(bh);
 	unlock_inode(inode);
+	journal_stop();
 }
+
+/*
+ * The last link is gone: the blocks are freed here unless truncd
+ * takes the inode over.
+ */
+static void minix_put_inode(struct m_inode * inode)
+{
+	if (free_later(inode))
+		return;
+	journal_start();
+	truncate(inode);
+	free_inode(inode);
+	journal_stop();
+}
+
+static void minix_put_super(struct super_block * sb)
+{
+	int i;
+
+	for(i=0;i<I_MAP_SLOTS;i++)
+		brelse(sb->s_imap[i]);
+	for(i=0;i<Z_MAP_SLOTS;i++)
+		brelse(sb->s_zmap[i]);
+}
+
+extern int file_read(struct m_inode * inode, struct file * filp,
+		char * buf, int count);
+extern int file_write(struct m_inode * inode, struct file * filp,
+		char * buf, int count);
+extern int minix_readdir(struct m_inode * inode, struct file * filp,
+		char * buf, int count, int flags);
+
+static struct file_operations minix_file_operations = {
+	file_read,
+	file_write,
+	minix_readdir,
+	minix_fsync
+};
+
+struct inode_operations minix_inode_operations = {
+	&minix_file_operations,
+	minix_lookup,
+	minix_create,
+	minix_mknod,
+	minix_mkdir,
+	minix_rmdir,
+	minix_unlink,
+	minix_symlink,
+	minix_link,
+	minix_follow_link,
+	bmap,
+	truncate
+};
+
+struct super_operations minix_super_operations = {
+	minix_read_inode,
+	minix_write_inode,
+	minix_put_inode,
+	minix_put_super
+};
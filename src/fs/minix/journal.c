@@ -0,0 +1,407 @@
+/*
+ *  linux/fs/minix/journal.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * journal.c implements an optional metadata journal for minix file
+ * systems, so that a crash doesn't need a full fsck.
+ *
+ * The journal is an ordinary, preallocated file. A record after the
+ * super-block data (in block 1) names its inode: journal() sets it up,
+ * old kernels just see a file. Block 0 of the journal is the header
+ * with the list of logged blocks, the copies follow in blocks 1..
+ *
+ * Anything that changes metadata runs between journal_start() and
+ * journal_stop(). A commit waits until nobody is inside, copies all
+ * dirty metadata buffers (bitmaps, inode table, directory and indirect
+ * blocks) into the journal, writes the header - that's the commit
+ * point - then the blocks themselves, and clears the header again.
+ * Mounting replays a header that was left behind.
+ *
+ * Until then the dirty metadata buffers are pinned: sync and getblk()
+ * leave them alone, so nothing reaches the disk uncommitted. A commit
+ * has to fit in the journal in one go, so journal_start() commits
+ * before the ones since the last commit could fill it: no transaction
+ * dirties more than JOURNAL_RESERVE blocks (long ones restart their
+ * handle), and the inodes changed outside of one take up NR_INODE more
+ * at the most.
+ */
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <asm/system.h>
+
+extern int sys_sync(void);
+
+#define JOURNAL_MAGIC	0x4a4e
+#define JOURNAL_OFFSET	512	/* of the record in block 1 */
+#define JOURNAL_OPS	32	/* commit at least this often */
+#define JOURNAL_MAX	((BLOCK_SIZE-2*sizeof (short))/sizeof (short))
+#define JOURNAL_RESERVE	32	/* most blocks a transaction dirties */
+#define JOURNAL_MIN	(JOURNAL_RESERVE+NR_INODE)
+
+struct d_journal_rec {
+	unsigned short j_magic;
+	unsigned short j_ino;
+};
+
+struct d_journal_head {
+	unsigned short h_magic;
+	unsigned short h_nr;
+	unsigned short h_block[JOURNAL_MAX];
+};
+
+static int journal_users = 0;
+static int journal_ops = 0;
+static struct task_struct * journal_wait = NULL;
+static struct task_struct * committer = NULL;
+
+#define IS_META(sb,bh) ((bh)->b_meta || (bh)->b_blocknr < (sb)->s_firstdatazone)
+
+/*
+ * Does one more transaction still fit in every journal?
+ */
+static int journal_full(void)
+{
+	struct super_block * sb;
+
+	if (journal_ops >= JOURNAL_OPS)
+		return 1;
+	for (sb = super_block ; sb < NR_SUPER+super_block ; sb++)
+		if (sb->s_dev && sb->s_journal && sb->s_jblocks <
+		    (journal_ops+1)*JOURNAL_RESERVE + NR_INODE)
+			return 1;
+	return 0;
+}
+
+/*
+ * Handles nest, and a process that already holds one never waits for
+ * a commit: the commit is waiting for it. Neither does the committer,
+ * which gets here writing out inodes.
+ */
+void journal_start(void)
+{
+	if (!current->journal && committer != current) {
+		while (committer || journal_full())
+			if (committer)
+				sleep_on(&journal_wait);
+			else
+				journal_sync();
+		journal_ops++;
+	}
+	current->journal++;
+	journal_users++;
+}
+
+void journal_stop(void)
+{
+	if (!current->journal)
+		panic("journal_stop: no handle");
+	current->journal--;
+	if (!--journal_users)
+		wake_up(&journal_wait);
+}
+
+/*
+ * A dirty metadata buffer of a journalled file system may only be
+ * written by journal_commit().
+ */
+int journal_pinned(struct buffer_head * bh)
+{
+	struct super_block * sb;
+
+	if (!bh->b_dirt)
+		return 0;
+	for (sb = super_block ; sb < NR_SUPER+super_block ; sb++)
+		if (sb->s_dev == bh->b_dev)
+			return sb->s_journal && IS_META(sb,bh);
+	return 0;
+}
+
+static int journal_block(struct super_block * sb, int nr)
+{
+	return bmap(sb->s_journal,nr);
+}
+
+/*
+ * Checks the journal file and sizes the journal: all of it has to fit
+ * in the buffer cache at once, with room to spare.
+ */
+static int journal_setup(struct super_block * sb, struct m_inode * inode)
+{
+	int nr;
+
+	if (!S_ISREG(inode->i_mode) || inode->i_size < 2*BLOCK_SIZE)
+		return -EINVAL;
+	nr = inode->i_size/BLOCK_SIZE - 1;
+	if (nr > JOURNAL_MAX)
+		nr = JOURNAL_MAX;
+	if (nr > NR_BUFFERS/4)
+		nr = NR_BUFFERS/4;
+	if (nr < JOURNAL_MIN)
+		return -EINVAL;
+	sb->s_journal = inode;
+	sb->s_jblocks = nr;
+	return 0;
+}
+
+/*
+ * journal_commit() returns the number of blocks committed, or -EBUSY if
+ * it can't commit right now (the caller holds a handle, or we are the
+ * committer and got here through getblk()). The blocks stay pinned
+ * then, until the commit that is due.
+ */
+int journal_commit(struct super_block * sb)
+{
+	struct buffer_head * bh, * hbh, * jbh;
+	struct d_journal_head * head;
+	struct m_inode * inode;
+	int i, nr, block;
+
+	if (!sb->s_journal)
+		return 0;
+	if (current->journal || committer == current)
+		return -EBUSY;
+	while (committer)
+		sleep_on(&journal_wait);
+	committer = current;
+	while (journal_users)
+		sleep_on(&journal_wait);
+	sync_inodes();
+	if (!(block = journal_block(sb,0)) || !(hbh = getblk(sb->s_dev,block))) {
+		committer = NULL;
+		wake_up(&journal_wait);
+		return -EIO;
+	}
+	head = (struct d_journal_head *) hbh->b_data;
+	memset(head,0,BLOCK_SIZE);
+	nr = 0;
+	bh = start_buffer;
+	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+		if (bh->b_dev != sb->s_dev || !bh->b_dirt || !IS_META(sb,bh))
+			continue;
+		if (nr >= sb->s_jblocks)
+			break;
+		bh->b_count++;		/* keep it until we're done */
+		head->h_block[nr++] = bh->b_blocknr;
+	}
+/*
+ * Can't happen, journal_start() sees to it. But if it does, committing
+ * part of it would be worse than no journal at all: turn it off.
+ */
+	if (i < NR_BUFFERS) {
+		printk("journal on %04x overflowed, turned off\n\r",sb->s_dev);
+		for (i=0 ; i<nr ; i++)
+			get_hash_table(sb->s_dev,head->h_block[i])->b_count -= 2;
+		brelse(hbh);
+		inode = sb->s_journal;
+		sb->s_journal = NULL;
+		committer = NULL;
+		wake_up(&journal_wait);
+		iput(inode);
+		return -ENOSPC;
+	}
+	if (!nr) {
+		brelse(hbh);
+		goto out;
+	}
+/* copy the blocks to the journal */
+	for (i=0 ; i<nr ; i++) {
+		jbh = NULL;
+		if (!(block = journal_block(sb,i+1)) ||
+		    !(jbh = getblk(sb->s_dev,block)))
+			panic("journal_commit: journal is gone");
+		bh = get_hash_table(sb->s_dev,head->h_block[i]);
+		memcpy(jbh->b_data,bh->b_data,BLOCK_SIZE);
+		bh->b_count--;
+		jbh->b_uptodate = 1;
+		jbh->b_dirt = 1;
+		ll_rw_block(WRITE,jbh);
+		jbh->b_count--;
+	}
+	for (i=0 ; i<nr ; i++)
+		if (bh = get_hash_table(sb->s_dev,journal_block(sb,i+1)))
+			brelse(bh);
+/* commit */
+	head->h_magic = JOURNAL_MAGIC;
+	head->h_nr = nr;
+	hbh->b_uptodate = 1;
+	hbh->b_dirt = 1;
+	ll_rw_block(WRITE,hbh);
+	brelse(hbh);
+/* and the real thing */
+	for (i=0 ; i<nr ; i++) {
+		bh = get_hash_table(sb->s_dev,head->h_block[i]);
+		if (bh->b_dirt)
+			ll_rw_block(WRITE,bh);
+		bh->b_count--;
+	}
+	for (i=0 ; i<nr ; i++) {
+		bh = get_hash_table(sb->s_dev,head->h_block[i]);
+		brelse(bh);
+		brelse(bh);
+	}
+	hbh = getblk(sb->s_dev,journal_block(sb,0));
+	((struct d_journal_head *) hbh->b_data)->h_nr = 0;
+	hbh->b_dirt = 1;
+	ll_rw_block(WRITE,hbh);
+	brelse(hbh);
+out:
+	committer = NULL;
+	wake_up(&journal_wait);
+	return nr;
+}
+
+/*
+ * Commit every journalled file system, returns the number of blocks
+ * that got unpinned. Committing only one of them doesn't reset the
+ * count, the others still have their blocks.
+ */
+int journal_sync(void)
+{
+	struct super_block * sb;
+	int i, nr = 0;
+
+	if (current->journal || committer == current)
+		return 0;
+	journal_ops = 0;
+	for (sb = super_block ; sb < NR_SUPER+super_block ; sb++)
+		if (sb->s_dev && sb->s_journal && (i = journal_commit(sb)) > 0)
+			nr += i;
+	return nr;
+}
+
+/*
+ * Long operations call this between steps that leave the file system
+ * consistent, so that no transaction gets too big for the journal.
+ */
+void journal_restart(void)
+{
+	if (current->journal != 1)
+		return;
+	journal_stop();
+	journal_start();
+}
+
+/*
+ * Called from read_super() once the bitmaps are in: find the journal,
+ * and write back whatever a crash left committed in it.
+ */
+void journal_replay(struct super_block * sb)
+{
+	struct buffer_head * bh, * src, * dst;
+	struct d_journal_rec * rec;
+	struct d_journal_head * head;
+	struct m_inode * inode;
+	int i, ino, block;
+
+	sb->s_journal = NULL;
+	if (!(bh = bread(sb->s_dev,1)))
+		return;
+	rec = (struct d_journal_rec *) (JOURNAL_OFFSET + bh->b_data);
+	ino = (rec->j_magic == JOURNAL_MAGIC) ? rec->j_ino : 0;
+	brelse(bh);
+	if (!ino)
+		return;
+	if (ino > sb->s_ninodes || !(inode = iget(sb->s_dev,ino)))
+		return;
+	if (journal_setup(sb,inode)) {
+		printk("journal inode %d on %04x unusable\n\r",ino,sb->s_dev);
+		iput(inode);
+		return;
+	}
+	if (!(block = journal_block(sb,0)) || !(bh = bread(sb->s_dev,block)))
+		return;
+	head = (struct d_journal_head *) bh->b_data;
+	if (head->h_magic != JOURNAL_MAGIC || !head->h_nr) {
+		brelse(bh);
+		return;
+	}
+	if (head->h_nr > JOURNAL_MAX ||
+	    head->h_nr >= sb->s_journal->i_size/BLOCK_SIZE) {
+		printk("journal on %04x is corrupt\n\r",sb->s_dev);
+		brelse(bh);
+		return;
+	}
+	for (i=0 ; i<head->h_nr ; i++) {
+		src = NULL;
+		if (!(block = journal_block(sb,i+1)) ||
+		    !(src = bread(sb->s_dev,block)))
+			panic("unable to read journal");
+		dst = getblk(sb->s_dev,head->h_block[i]);
+		memcpy(dst->b_data,src->b_data,BLOCK_SIZE);
+		dst->b_uptodate = 1;
+		dst->b_dirt = 1;
+		ll_rw_block(WRITE,dst);
+		brelse(dst);
+		brelse(src);
+	}
+	printk("%04x: replayed %d journal blocks\n\r",sb->s_dev,head->h_nr);
+	head->h_nr = 0;
+	bh->b_dirt = 1;
+	ll_rw_block(WRITE,bh);
+	brelse(bh);
+}
+
+/*
+ * journal(fd) makes the open file the journal of its file system. It
+ * has to be there in full (no holes), and nobody should write to it
+ * afterwards: the record in block 1 is what makes it stick.
+ */
+int sys_journal(unsigned int fd)
+{
+	struct file * file;
+	struct m_inode * inode;
+	struct super_block * sb;
+	struct buffer_head * bh;
+	struct d_journal_rec * rec;
+	int i, block, error;
+
+	if (!suser())
+		return -EPERM;
+	if (fd >= NR_OPEN || !(file=current->filp[fd]) ||
+	    !(inode=file->f_inode))
+		return -EBADF;
+	if (!(sb = get_super(inode->i_dev)) || sb->s_magic != SUPER_MAGIC)
+		return -EINVAL;
+	if (sb->s_rd_only)
+		return -EROFS;
+	if (sb->s_journal)
+		return -EBUSY;
+	for (i=0 ; i<inode->i_size/BLOCK_SIZE ; i++)
+		if (!bmap(inode,i))
+			return -EINVAL;
+	inode->i_count++;
+	if (error = journal_setup(sb,inode)) {
+		iput(inode);
+		return error;
+	}
+	sb->s_journal = NULL;		/* not before it's all on the disk */
+	if (!(block = journal_block(sb,0)) || !(bh = getblk(sb->s_dev,block))) {
+		iput(inode);
+		return -EIO;
+	}
+	memset(bh->b_data,0,BLOCK_SIZE);
+	bh->b_uptodate = 1;
+	bh->b_dirt = 1;
+	ll_rw_block(WRITE,bh);
+	brelse(bh);
+	sys_sync();
+	if (!(bh = bread(sb->s_dev,1))) {
+		iput(inode);
+		return -EIO;
+	}
+	rec = (struct d_journal_rec *) (JOURNAL_OFFSET + bh->b_data);
+	rec->j_magic = JOURNAL_MAGIC;
+	rec->j_ino = inode->i_num;
+	bh->b_dirt = 1;
+	ll_rw_block(WRITE,bh);
+	brelse(bh);
+	sb->s_journal = inode;
+	return 0;
+}
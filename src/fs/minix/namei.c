@@ -1,5 +1,5 @@
 /*
- *  linux/fs/namei.c
+ *  linux/fs/minix/namei.c
  *
  *  (C) 1991  Linus Torvalds
  */
@@ -18,44 +18,12 @@
 #include <const.h>
 #include <sys/stat.h>
 
-static struct m_inode * _namei(const char * filename, struct m_inode * base,
-	int follow_links);
-
-#define ACC_MODE(x) ("\004\002\006\377"[(x)&O_ACCMODE])
-
 /*
  * comment out this line if you want names > NAME_LEN chars to be
  * truncated. Else they will be disallowed.
  */
 /* #define NO_TRUNCATE */
 
-#define MAY_EXEC 1
-#define MAY_WRITE 2
-#define MAY_READ 4
-
-/*
- *	permission()
- *
- * is used to check for read/write/execute permissions on a file.
- * I don't know if we should look at just the euid or both euid and
- * uid, but that should be easily changed.
- */
-static int permission(struct m_inode * inode,int mask)
-{
-	int mode = inode->i_mode;
-
-/* special case: not even root can read/write a deleted file */
-	if (inode->i_dev && !inode->i_nlinks)
-		return 0;
-	else if (current->euid==inode->i_uid)
-		mode >>= 6;
-	else if (in_group_p(inode->i_gid))
-		mode >>= 3;
-	if (((mode & mask & 0007) == mask) || suser())
-		return 1;
-	return 0;
-}
-
 /*
  * ok, we cannot use strncmp, as the name is not in our data space.
  * Thus we'll have to use match. No big problem. Match also makes
@@ -83,25 +51,389 @@ static int match(int len,const char * name,struct dir_entry * de)
 	return same;
 }
 
+/*
+ * Hashed directories.
+ *
+ * Big directories get an open-addressed hash table of entry numbers,
+ * kept in blocks DX_FIRST.. of the directory itself. They lie far beyond
+ * i_size, so old kernels (and fsck) see a plain minix directory that
+ * just happens to own a few more zones. The table header remembers the
+ * i_size and i_mtime it was last synced with: anybody that changes the
+ * directory behind our back changes one of them, and we simply rebuild.
+ */
+#define DX_MAGIC	0x5844
+#define DX_MAX_BLOCKS	32
+#define DX_FIRST	(7+512-DX_MAX_BLOCKS)
+#define DX_MIN_BLOCKS	4
+#define DX_SLOTS	(BLOCK_SIZE/sizeof (unsigned short))
+#define DX_HEAD_SLOTS	(sizeof (struct dx_head)/sizeof (unsigned short))
+#define DX_EMPTY	0
+#define DX_DELETED	0xffff
+
+struct dx_head {
+	unsigned short d_magic;
+	unsigned short d_ino;
+	unsigned short d_blocks;	/* nr of table blocks */
+	unsigned short d_used;		/* live + deleted slots */
+	unsigned short d_free;		/* add_entry() hint */
+	unsigned short d_unused;
+	unsigned long d_size;		/* i_size and i_mtime when synced */
+	unsigned long d_mtime;
+};
+
+/* only one table is built at a time: anybody else does a linear scan */
+static struct m_inode * dx_building = NULL;
+static int dx_aborted = 0;
+
+static unsigned long dx_hash(const char * name, int len, int user)
+{
+	unsigned long hash = 0;
+	char c;
+
+	while (len-- > 0) {
+		if (!(c = user ? get_fs_byte(name++) : *(name++)))
+			break;
+		hash = (hash << 4) + (hash >> 28) + (unsigned char) c;
+	}
+	return hash;
+}
+
+/*
+ * dx_slot() returns a pointer to table slot 'nr', keeping the table
+ * block it is in around in *bh (*cur is its index, -1 for none).
+ */
+static unsigned short * dx_slot(struct m_inode * dir, int nr,
+	struct buffer_head ** bh, int * cur)
+{
+	int block;
+
+	nr += DX_HEAD_SLOTS;
+	if (*cur != nr/DX_SLOTS) {
+		brelse(*bh);
+		*bh = NULL;
+		*cur = nr/DX_SLOTS;
+		if (!(block = bmap(dir,DX_FIRST + *cur)) ||
+		    !(*bh = bread(dir->i_dev,block))) {
+			*cur = -1;
+			return NULL;
+		}
+	}
+	return (nr % DX_SLOTS) + (unsigned short *) (*bh)->b_data;
+}
+
+static void dx_stamp(struct m_inode * dir, struct buffer_head * head)
+{
+	struct dx_head * h = (struct dx_head *) head->b_data;
+
+	h->d_size = dir->i_size;
+	h->d_mtime = dir->i_mtime;
+	h->d_free = (dir->i_dir_free < 0xffff) ? dir->i_dir_free : 0xffff;
+	head->b_dirt = 1;
+}
+
+/*
+ * dx_head() returns the table header of 'dir' if it has an up-to-date
+ * table, NULL otherwise.
+ */
+static struct buffer_head * dx_head(struct m_inode * dir)
+{
+	struct buffer_head * bh;
+	struct dx_head * h;
+	int block;
+
+	if (dir->i_size <= DX_MIN_BLOCKS*BLOCK_SIZE || dir == dx_building)
+		return NULL;
+	if (!(block = bmap(dir,DX_FIRST)) || !(bh = bread(dir->i_dev,block)))
+		return NULL;
+	h = (struct dx_head *) bh->b_data;
+	if (h->d_magic == DX_MAGIC && h->d_ino == dir->i_num &&
+	    h->d_size == dir->i_size && h->d_mtime == dir->i_mtime &&
+	    h->d_blocks && h->d_blocks <= DX_MAX_BLOCKS) {
+		if (h->d_free > dir->i_dir_free)
+			dir->i_dir_free = h->d_free;
+		return bh;
+	}
+	brelse(bh);
+	return NULL;
+}
+
+/*
+ * dx_drop() gives the table blocks back: the directory itself is about
+ * to grow into them, or building the table failed halfway.
+ */
+static void dx_drop(struct m_inode * dir)
+{
+	struct buffer_head * ind, * bh;
+	unsigned short * p;
+	int i;
+
+	if (!dir->i_zone[7] || !(ind = bread(dir->i_dev,dir->i_zone[7])))
+		return;
+	p = (DX_FIRST-7) + (unsigned short *) ind->b_data;
+	for (i = 0 ; i < DX_MAX_BLOCKS ; i++,p++) {
+		if (!*p)
+			continue;
+		if (bh = getblk(dir->i_dev,*p)) {
+			memset(bh->b_data,0,BLOCK_SIZE);
+			bh->b_uptodate = 1;
+			bh->b_dirt = 1;
+			brelse(bh);
+		}
+		if (free_block(dir->i_dev,*p)) {
+			*p = 0;
+			ind->b_meta = ind->b_dirt = 1;
+		}
+	}
+	brelse(ind);
+}
+
+/*
+ * dx_build() (re)creates the table of 'dir' with a linear scan, sized
+ * so that it is at most 3/8 full. It returns the header, or NULL if the
+ * directory is too big or somebody changed it while we slept: then the
+ * table blocks are given back. Only add_entry() builds tables, lookups
+ * never allocate anything.
+ */
+static struct buffer_head * dx_build(struct m_inode * dir)
+{
+	struct buffer_head * head = NULL, * bh = NULL, * tbh = NULL;
+	struct dir_entry * de = NULL;
+	struct dx_head * h;
+	struct super_block * sb;
+	unsigned short * p;
+	int entries, nslots, nb, i, s, n, block, cur = -1;
+	int first_free;
+
+	if (dir->i_size <= DX_MIN_BLOCKS*BLOCK_SIZE || dx_building ||
+	    !(sb = get_super(dir->i_dev)) || sb->s_rd_only)
+		return NULL;
+	entries = dir->i_size / (sizeof (struct dir_entry));
+	if (entries > DX_FIRST*DIR_ENTRIES_PER_BLOCK)
+		return NULL;
+	nb = (entries*8/3 + DX_HEAD_SLOTS)/DX_SLOTS + 1;
+	if (nb > DX_MAX_BLOCKS)
+		nb = DX_MAX_BLOCKS;
+	nslots = nb*DX_SLOTS - DX_HEAD_SLOTS;
+	if (entries*4 > nslots*3)
+		return NULL;
+	dx_building = dir;
+	dx_aborted = 0;
+	for (i = nb-1 ; i >= 0 ; i--) {
+		if (!(block = create_block(dir,DX_FIRST+i)) ||
+		    !(bh = bread(dir->i_dev,block)))
+			goto out;
+		memset(bh->b_data,0,BLOCK_SIZE);
+		bh->b_dirt = 1;
+		if (i)
+			brelse(bh);
+		else
+			head = bh;
+	}
+	bh = NULL;
+	h = (struct dx_head *) head->b_data;
+	h->d_ino = dir->i_num;
+	h->d_blocks = nb;
+	first_free = entries;
+	for (i = 0 ; i < entries ; i++,de++) {
+		if (!(i % DIR_ENTRIES_PER_BLOCK)) {
+			brelse(bh);
+			if (!(block = bmap(dir,i/DIR_ENTRIES_PER_BLOCK)) ||
+			    !(bh = bread(dir->i_dev,block))) {
+				bh = NULL;
+				if (i < first_free)
+					first_free = i;
+				i += DIR_ENTRIES_PER_BLOCK-1;
+				continue;
+			}
+			de = (struct dir_entry *) bh->b_data;
+		}
+		if (!de->inode) {
+			if (i < first_free)
+				first_free = i;
+			continue;
+		}
+		s = dx_hash(de->name,NAME_LEN,0) % nslots;
+		for (n = 0 ; n < nslots ; n++) {
+			if (!(p = dx_slot(dir,s,&tbh,&cur)))
+				goto out;
+			if (*p == DX_EMPTY)
+				break;
+			if (++s >= nslots)
+				s = 0;
+		}
+		if (n >= nslots)
+			goto out;
+		*p = i+1;
+		tbh->b_dirt = 1;
+		h->d_used++;
+	}
+	if (dx_aborted)
+		goto out;
+	h->d_magic = DX_MAGIC;
+	dir->i_dir_free = first_free;
+	dx_stamp(dir,head);
+	brelse(bh);
+	brelse(tbh);
+	dx_building = NULL;
+	return head;
+out:
+	brelse(bh);
+	brelse(tbh);
+	brelse(head);
+	dx_drop(dir);
+	dx_building = NULL;
+	return NULL;
+}
+
+/*
+ * dx_find() looks 'name' up in the table. It returns 0 if there is no
+ * usable table (do it the slow way), 1 if the answer in *res_bh is
+ * final.
+ */
+static int dx_find(struct m_inode * dir, const char * name, int namelen,
+	struct buffer_head ** res_bh, struct dir_entry ** res_dir, int * res_nr)
+{
+	struct buffer_head * head, * bh, * tbh = NULL;
+	struct dx_head * h;
+	struct dir_entry * de;
+	unsigned short * p;
+	int nslots, s, n, nr, block, cur = -1;
+
+	if (!namelen || !(head = dx_head(dir)))
+		return 0;
+	h = (struct dx_head *) head->b_data;
+	nslots = h->d_blocks*DX_SLOTS - DX_HEAD_SLOTS;
+	s = dx_hash(name,namelen,1) % nslots;
+	for (n = 0 ; n < nslots ; n++) {
+		if (!(p = dx_slot(dir,s,&tbh,&cur)))
+			break;
+		if (*p == DX_EMPTY) {
+			brelse(tbh);
+			brelse(head);
+			return 1;
+		}
+		nr = *p - 1;
+		if (*p != DX_DELETED &&
+		    nr*sizeof (struct dir_entry) < dir->i_size &&
+		    (block = bmap(dir,nr/DIR_ENTRIES_PER_BLOCK)) &&
+		    (bh = bread(dir->i_dev,block))) {
+			de = nr % DIR_ENTRIES_PER_BLOCK +
+				(struct dir_entry *) bh->b_data;
+			if (match(namelen,name,de)) {
+				brelse(tbh);
+				brelse(head);
+				*res_bh = bh;
+				*res_dir = de;
+				if (res_nr)
+					*res_nr = nr;
+				return 1;
+			}
+			brelse(bh);
+		}
+		if (++s >= nslots)
+			s = 0;
+	}
+	brelse(tbh);
+	brelse(head);
+	return 0;
+}
+
+/*
+ * dx_insert() and dx_delete() record a change done to entry 'nr' (called
+ * 'name') of 'dir' in the table. 'head' is what dx_head() returned
+ * before the directory was touched: they release it.
+ */
+static void dx_insert(struct m_inode * dir, struct buffer_head * head,
+	int nr, const char * name)
+{
+	struct buffer_head * tbh = NULL;
+	struct dx_head * h;
+	unsigned short * p;
+	int nslots, s, n, cur = -1;
+
+	if (dir == dx_building)
+		dx_aborted = 1;
+	if (!head)
+		return;
+	h = (struct dx_head *) head->b_data;
+	nslots = h->d_blocks*DX_SLOTS - DX_HEAD_SLOTS;
+	if (h->d_magic != DX_MAGIC || (h->d_used+1)*4 > nslots*3 ||
+	    nr >= DX_DELETED) {
+		h->d_magic = 0;		/* rebuild it bigger next time */
+		head->b_dirt = 1;
+		brelse(head);
+		return;
+	}
+	s = dx_hash(name,NAME_LEN,0) % nslots;
+	for (n = 0 ; n < nslots ; n++) {
+		if (!(p = dx_slot(dir,s,&tbh,&cur)))
+			break;
+		if (*p == DX_EMPTY || *p == DX_DELETED) {
+			if (*p == DX_EMPTY)
+				h->d_used++;
+			*p = nr+1;
+			tbh->b_dirt = 1;
+			break;
+		}
+		if (++s >= nslots)
+			s = 0;
+	}
+	brelse(tbh);
+	if (n >= nslots || !p)
+		h->d_magic = 0;
+	dx_stamp(dir,head);
+	brelse(head);
+}
+
+static void dx_delete(struct m_inode * dir, struct buffer_head * head,
+	int nr, const char * name)
+{
+	struct buffer_head * tbh = NULL;
+	struct dx_head * h;
+	unsigned short * p;
+	int nslots, s, n, cur = -1;
+
+	if (dir == dx_building)
+		dx_aborted = 1;
+	if (!head)
+		return;
+	h = (struct dx_head *) head->b_data;
+	nslots = h->d_blocks*DX_SLOTS - DX_HEAD_SLOTS;
+	s = dx_hash(name,NAME_LEN,0) % nslots;
+	for (n = 0 ; n < nslots ; n++) {
+		if (!(p = dx_slot(dir,s,&tbh,&cur)) || *p == DX_EMPTY)
+			break;
+		if (*p == nr+1) {
+			*p = DX_DELETED;
+			tbh->b_dirt = 1;
+			break;
+		}
+		if (++s >= nslots)
+			s = 0;
+	}
+	brelse(tbh);
+	if (n >= nslots || !p || *p != DX_DELETED)
+		h->d_magic = 0;
+	dx_stamp(dir,head);
+	brelse(head);
+}
+
 /*
  *	find_entry()
  *
  * finds an entry in the specified directory with the wanted name. It
  * returns the cache buffer in which the entry was found, and the entry
- * itself (as a parameter - res_dir). It does NOT read the inode of the
- * entry - you'll have to do that yourself if you want to.
- *
- * This also takes care of the few special cases due to '..'-traversal
- * over a pseudo-root and a mount point.
+ * itself (as a parameter - res_dir), and its number if res_nr isn't NULL.
+ * It does NOT read the inode of the entry - you'll have to do that
+ * yourself if you want to. Big directories are looked up by hash.
  */
-static struct buffer_head * find_entry(struct m_inode ** dir,
-	const char * name, int namelen, struct dir_entry ** res_dir)
+static struct buffer_head * find_entry(struct m_inode * dir,
+	const char * name, int namelen, struct dir_entry ** res_dir, int * res_nr)
 {
 	int entries;
 	int block,i;
-	struct buffer_head * bh;
+	struct buffer_head * bh = NULL;
 	struct dir_entry * de;
-	struct super_block * sb;
 
 #ifdef NO_TRUNCATE
 	if (namelen > NAME_LEN)
@@ -110,27 +442,13 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 	if (namelen > NAME_LEN)
 		namelen = NAME_LEN;
 #endif
-	entries = (*dir)->i_size / (sizeof (struct dir_entry));
+	entries = dir->i_size / (sizeof (struct dir_entry));
 	*res_dir = NULL;
-/* check for '..', as we might have to do some "magic" for it */
-	if (namelen==2 && get_fs_byte(name)=='.' && get_fs_byte(name+1)=='.') {
-/* '..' in a pseudo-root results in a faked '.' (just change namelen) */
-		if ((*dir) == current->root)
-			namelen=1;
-		else if ((*dir)->i_num == ROOT_INO) {
-/* '..' over a mount-point results in 'dir' being exchanged for the mounted
-   directory-inode. NOTE! We set mounted, so that we can iput the new dir */
-			sb=get_super((*dir)->i_dev);
-			if (sb->s_imount) {
-				iput(*dir);
-				(*dir)=sb->s_imount;
-				(*dir)->i_count++;
-			}
-		}
-	}
-	if (!(block = (*dir)->i_zone[0]))
+	if (dx_find(dir,name,namelen,&bh,res_dir,res_nr))
+		return *res_dir ? bh : NULL;
+	if (!(block = dir->i_zone[0]))
 		return NULL;
-	if (!(bh = bread((*dir)->i_dev,block)))
+	if (!(bh = bread(dir->i_dev,block)))
 		return NULL;
 	i = 0;
 	de = (struct dir_entry *) bh->b_data;
@@ -138,8 +456,8 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 		if ((char *)de >= BLOCK_SIZE+bh->b_data) {
 			brelse(bh);
 			bh = NULL;
-			if (!(block = bmap(*dir,i/DIR_ENTRIES_PER_BLOCK)) ||
-			    !(bh = bread((*dir)->i_dev,block))) {
+			if (!(block = bmap(dir,i/DIR_ENTRIES_PER_BLOCK)) ||
+			    !(bh = bread(dir->i_dev,block))) {
 				i += DIR_ENTRIES_PER_BLOCK;
 				continue;
 			}
@@ -147,6 +465,8 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 		}
 		if (match(namelen,name,de)) {
 			*res_dir = de;
+			if (res_nr)
+				*res_nr = i;
 			return bh;
 		}
 		de++;
@@ -159,19 +479,20 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 /*
  *	add_entry()
  *
- * adds a file entry to the specified directory, using the same
- * semantics as find_entry(). It returns NULL if it failed.
+ * adds a file entry for inode 'ino' to the specified directory, using
+ * the same semantics as find_entry(). It returns NULL if it failed.
+ *
+ * The entry gets its inode number before the hash table is updated:
+ * that can sleep, and an entry with inode 0 is free for the taking.
  *
- * NOTE!! The inode part of 'de' is left at 0 - which means you
- * may not sleep between calling this and putting something into
- * the entry, as someone else might have used it while you slept.
+ * The search starts at dir->i_dir_free: everything below it is in use.
  */
 static struct buffer_head * add_entry(struct m_inode * dir,
-	const char * name, int namelen, struct dir_entry ** res_dir)
+	const char * name, int namelen, struct dir_entry ** res_dir, int ino)
 {
-	int block,i;
-	struct buffer_head * bh;
-	struct dir_entry * de;
+	int block,i,j;
+	struct buffer_head * bh, * head;
+	struct dir_entry * de = NULL;
 
 	*res_dir = NULL;
 #ifdef NO_TRUNCATE
@@ -183,24 +504,34 @@ static struct buffer_head * add_entry(struct m_inode * dir,
 #endif
 	if (!namelen)
 		return NULL;
-	if (!(block = dir->i_zone[0]))
-		return NULL;
-	if (!(bh = bread(dir->i_dev,block)))
+	if (!dir->i_zone[0])
 		return NULL;
-	i = 0;
-	de = (struct dir_entry *) bh->b_data;
+	if (!(head = dx_head(dir)))
+		head = dx_build(dir);
+	i = dir->i_size / (sizeof (struct dir_entry));
+	if (dir->i_dir_free < i)
+		i = dir->i_dir_free;
+	bh = NULL;
 	while (1) {
-		if ((char *)de >= BLOCK_SIZE+bh->b_data) {
+		if (!bh || (char *)de >= BLOCK_SIZE+bh->b_data) {
 			brelse(bh);
 			bh = NULL;
+			if (i == DX_FIRST*DIR_ENTRIES_PER_BLOCK &&
+			    i*sizeof(struct dir_entry) >= dir->i_size) {
+				brelse(head);
+				head = NULL;
+				dx_drop(dir);
+			}
 			block = create_block(dir,i/DIR_ENTRIES_PER_BLOCK);
-			if (!block)
+			if (!block) {
+				brelse(head);
 				return NULL;
+			}
 			if (!(bh = bread(dir->i_dev,block))) {
-				i += DIR_ENTRIES_PER_BLOCK;
+				i += DIR_ENTRIES_PER_BLOCK - i%DIR_ENTRIES_PER_BLOCK;
 				continue;
 			}
-			de = (struct dir_entry *) bh->b_data;
+			de = i%DIR_ENTRIES_PER_BLOCK + (struct dir_entry *) bh->b_data;
 		}
 		if (i*sizeof(struct dir_entry) >= dir->i_size) {
 			de->inode=0;
@@ -210,9 +541,12 @@ static struct buffer_head * add_entry(struct m_inode * dir,
 		}
 		if (!de->inode) {
 			dir->i_mtime = CURRENT_TIME;
-			for (i=0; i < NAME_LEN ; i++)
-				de->name[i]=(i<namelen)?get_fs_byte(name+i):0;
-			bh->b_dirt = 1;
+			for (j=0; j < NAME_LEN ; j++)
+				de->name[j]=(j<namelen)?get_fs_byte(name+j):0;
+			de->inode = ino;
+			bh->b_meta = bh->b_dirt = 1;
+			dir->i_dir_free = i+1;
+			dx_insert(dir,head,i,de->name);
 			*res_dir = de;
 			return bh;
 		}
@@ -220,26 +554,32 @@ static struct buffer_head * add_entry(struct m_inode * dir,
 		i++;
 	}
 	brelse(bh);
+	brelse(head);
 	return NULL;
 }
 
-static struct m_inode * follow_link(struct m_inode * dir, struct m_inode * inode)
+int minix_lookup(struct m_inode * dir, const char * name, int len,
+	struct m_inode ** result)
+{
+	int ino;
+	struct buffer_head * bh;
+	struct dir_entry * de;
+
+	*result = NULL;
+	if (!(bh = find_entry(dir,name,len,&de,NULL)))
+		return -ENOENT;
+	ino = de->inode;
+	brelse(bh);
+	if (!(*result = iget(dir->i_dev,ino)))
+		return -EACCES;
+	return 0;
+}
+
+struct m_inode * minix_follow_link(struct m_inode * dir, struct m_inode * inode)
 {
 	unsigned short fs;
 	struct buffer_head * bh;
 
-	if (!dir) {
-		dir = current->root;
-		dir->i_count++;
-	}
-	if (!inode) {
-		iput(dir);
-		return NULL;
-	}
-	if (!S_ISLNK(inode->i_mode)) {
-		iput(dir);
-		return inode;
-	}
 	__asm__("mov %%fs,%0":"=r" (fs));
 	if (fs != 0x17 || !inode->i_zone[0] ||
 	   !(bh = bread(inode->i_dev, inode->i_zone[0]))) {
@@ -255,304 +595,88 @@ static struct m_inode * follow_link(struct m_inode * dir, struct m_inode * inode
 	return inode;
 }
 
-/*
- *	get_dir()
- *
- * Getdir traverses the pathname until it hits the topmost directory.
- * It returns NULL on failure.
- */
-static struct m_inode * get_dir(const char * pathname, struct m_inode * inode)
+int minix_create(struct m_inode * dir, const char * name, int len, int mode,
+	struct m_inode ** result)
 {
-	char c;
-	const char * thisname;
-	struct buffer_head * bh;
-	int namelen,inr;
-	struct dir_entry * de;
-	struct m_inode * dir;
-
-	if (!inode) {
-		inode = current->pwd;
-		inode->i_count++;
-	}
-	if ((c=get_fs_byte(pathname))=='/') {
-		iput(inode);
-		inode = current->root;
-		pathname++;
-		inode->i_count++;
-	}
-	while (1) {
-		thisname = pathname;
-		if (!S_ISDIR(inode->i_mode) || !permission(inode,MAY_EXEC)) {
-			iput(inode);
-			return NULL;
-		}
-		for(namelen=0;(c=get_fs_byte(pathname++))&&(c!='/');namelen++)
-			/* nothing */ ;
-		if (!c)
-			return inode;
-		if (!(bh = find_entry(&inode,thisname,namelen,&de))) {
-			iput(inode);
-			return NULL;
-		}
-		inr = de->inode;
-		brelse(bh);
-		dir = inode;
-		if (!(inode = iget(dir->i_dev,inr))) {
-			iput(dir);
-			return NULL;
-		}
-		if (!(inode = follow_link(dir,inode)))
-			return NULL;
-	}
-}
-
-/*
- *	dir_namei()
- *
- * dir_namei() returns the inode of the directory of the
- * specified name, and the name within that directory.
- */
-static struct m_inode * dir_namei(const char * pathname,
-	int * namelen, const char ** name, struct m_inode * base)
-{
-	char c;
-	const char * basename;
-	struct m_inode * dir;
-
-	if (!(dir = get_dir(pathname,base)))
-		return NULL;
-	basename = pathname;
-	while (c=get_fs_byte(pathname++))
-		if (c=='/')
-			basename=pathname;
-	*namelen = pathname-basename-1;
-	*name = basename;
-	return dir;
-}
-
-struct m_inode * _namei(const char * pathname, struct m_inode * base,
-	int follow_links)
-{
-	const char * basename;
-	int inr,namelen;
 	struct m_inode * inode;
 	struct buffer_head * bh;
 	struct dir_entry * de;
 
-	if (!(base = dir_namei(pathname,&namelen,&basename,base)))
-		return NULL;
-	if (!namelen)			/* special case: '/usr/' etc */
-		return base;
-	bh = find_entry(&base,basename,namelen,&de);
-	if (!bh) {
-		iput(base);
-		return NULL;
-	}
-	inr = de->inode;
-	brelse(bh);
-	if (!(inode = iget(base->i_dev,inr))) {
-		iput(base);
-		return NULL;
-	}
-	if (follow_links)
-		inode = follow_link(base,inode);
-	else
-		iput(base);
-	inode->i_atime=CURRENT_TIME;
-	inode->i_dirt=1;
-	return inode;
-}
-
-struct m_inode * lnamei(const char * pathname)
-{
-	return _namei(pathname, NULL, 0);
-}
-
-/*
- *	namei()
- *
- * is used by most simple commands to get the inode of a specified name.
- * Open, link etc use their own routines, but this is enough for things
- * like 'chmod' etc.
- */
-struct m_inode * namei(const char * pathname)
-{
-	return _namei(pathname,NULL,1);
-}
-
-/*
- *	open_namei()
- *
- * namei for open - this is in fact almost the whole open-routine.
- */
-int open_namei(const char * pathname, int flag, int mode,
-	struct m_inode ** res_inode)
-{
-	const char * basename;
-	int inr,dev,namelen;
-	struct m_inode * dir, *inode;
-	struct buffer_head * bh;
-	struct dir_entry * de;
-
-	if ((flag & O_TRUNC) && !(flag & O_ACCMODE))
-		flag |= O_WRONLY;
-	mode &= 0777 & ~current->umask;
-	mode |= I_REGULAR;
-	if (!(dir = dir_namei(pathname,&namelen,&basename,NULL)))
-		return -ENOENT;
-	if (!namelen) {			/* special case: '/usr/' etc */
-		if (!(flag & (O_ACCMODE|O_CREAT|O_TRUNC))) {
-			*res_inode=dir;
-			return 0;
-		}
-		iput(dir);
-		return -EISDIR;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
+	*result = NULL;
+	inode = new_inode(dir->i_dev);
+	if (!inode)
+		return -ENOSPC;
+	inode->i_uid = current->euid;
+	inode->i_mode = mode;
+	inode->i_dirt = 1;
+	bh = add_entry(dir,name,len,&de,inode->i_num);
 	if (!bh) {
-		if (!(flag & O_CREAT)) {
-			iput(dir);
-			return -ENOENT;
-		}
-		if (!permission(dir,MAY_WRITE)) {
-			iput(dir);
-			return -EACCES;
-		}
-		inode = new_inode(dir->i_dev);
-		if (!inode) {
-			iput(dir);
-			return -ENOSPC;
-		}
-		inode->i_uid = current->euid;
-		inode->i_mode = mode;
-		inode->i_dirt = 1;
-		bh = add_entry(dir,basename,namelen,&de);
-		if (!bh) {
-			inode->i_nlinks--;
-			iput(inode);
-			iput(dir);
-			return -ENOSPC;
-		}
-		de->inode = inode->i_num;
-		bh->b_dirt = 1;
-		brelse(bh);
-		iput(dir);
-		*res_inode = inode;
-		return 0;
-	}
-	inr = de->inode;
-	dev = dir->i_dev;
-	brelse(bh);
-	if (flag & O_EXCL) {
-		iput(dir);
-		return -EEXIST;
-	}
-	if (!(inode = follow_link(dir,iget(dev,inr))))
-		return -EACCES;
-	if ((S_ISDIR(inode->i_mode) && (flag & O_ACCMODE)) ||
-	    !permission(inode,ACC_MODE(flag))) {
+		inode->i_nlinks--;
 		iput(inode);
-		return -EPERM;
+		return -ENOSPC;
 	}
-	inode->i_atime = CURRENT_TIME;
-	if (flag & O_TRUNC)
-		truncate(inode);
-	*res_inode = inode;
+	bh->b_meta = bh->b_dirt = 1;
+	brelse(bh);
+	*result = inode;
 	return 0;
 }
 
-int sys_mknod(const char * filename, int mode, int dev)
+int minix_mknod(struct m_inode * dir, const char * name, int len, int mode,
+	int rdev)
 {
-	const char * basename;
-	int namelen;
-	struct m_inode * dir, * inode;
+	struct m_inode * inode;
 	struct buffer_head * bh;
 	struct dir_entry * de;
-	
-	if (!suser())
-		return -EPERM;
-	if (!(dir = dir_namei(filename,&namelen,&basename, NULL)))
-		return -ENOENT;
-	if (!namelen) {
-		iput(dir);
-		return -ENOENT;
-	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		return -EPERM;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
+
+	bh = find_entry(dir,name,len,&de,NULL);
 	if (bh) {
 		brelse(bh);
-		iput(dir);
 		return -EEXIST;
 	}
 	inode = new_inode(dir->i_dev);
-	if (!inode) {
-		iput(dir);
+	if (!inode)
 		return -ENOSPC;
-	}
 	inode->i_mode = mode;
 	if (S_ISBLK(mode) || S_ISCHR(mode))
-		inode->i_zone[0] = dev;
+		inode->i_zone[0] = rdev;
 	inode->i_mtime = inode->i_atime = CURRENT_TIME;
 	inode->i_dirt = 1;
-	bh = add_entry(dir,basename,namelen,&de);
+	bh = add_entry(dir,name,len,&de,inode->i_num);
 	if (!bh) {
-		iput(dir);
 		inode->i_nlinks=0;
 		iput(inode);
 		return -ENOSPC;
 	}
-	de->inode = inode->i_num;
-	bh->b_dirt = 1;
-	iput(dir);
+	bh->b_meta = bh->b_dirt = 1;
 	iput(inode);
 	brelse(bh);
 	return 0;
 }
 
-int sys_mkdir(const char * pathname, int mode)
+int minix_mkdir(struct m_inode * dir, const char * name, int len, int mode)
 {
-	const char * basename;
-	int namelen;
-	struct m_inode * dir, * inode;
+	struct m_inode * inode;
 	struct buffer_head * bh, *dir_block;
 	struct dir_entry * de;
 
-	if (!(dir = dir_namei(pathname,&namelen,&basename, NULL)))
-		return -ENOENT;
-	if (!namelen) {
-		iput(dir);
-		return -ENOENT;
-	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		return -EPERM;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
+	bh = find_entry(dir,name,len,&de,NULL);
 	if (bh) {
 		brelse(bh);
-		iput(dir);
 		return -EEXIST;
 	}
 	inode = new_inode(dir->i_dev);
-	if (!inode) {
-		iput(dir);
+	if (!inode)
 		return -ENOSPC;
-	}
 	inode->i_size = 32;
 	inode->i_dirt = 1;
 	inode->i_mtime = inode->i_atime = CURRENT_TIME;
 	if (!(inode->i_zone[0]=new_block(inode->i_dev))) {
-		iput(dir);
 		inode->i_nlinks--;
 		iput(inode);
 		return -ENOSPC;
 	}
 	inode->i_dirt = 1;
 	if (!(dir_block=bread(inode->i_dev,inode->i_zone[0]))) {
-		iput(dir);
 		inode->i_nlinks--;
 		iput(inode);
 		return -ERROR;
@@ -564,22 +688,19 @@ int sys_mkdir(const char * pathname, int mode)
 	de->inode = dir->i_num;
 	strcpy(de->name,"..");
 	inode->i_nlinks = 2;
-	dir_block->b_dirt = 1;
+	dir_block->b_meta = dir_block->b_dirt = 1;
 	brelse(dir_block);
 	inode->i_mode = I_DIRECTORY | (mode & 0777 & ~current->umask);
 	inode->i_dirt = 1;
-	bh = add_entry(dir,basename,namelen,&de);
+	bh = add_entry(dir,name,len,&de,inode->i_num);
 	if (!bh) {
-		iput(dir);
 		inode->i_nlinks=0;
 		iput(inode);
 		return -ENOSPC;
 	}
-	de->inode = inode->i_num;
-	bh->b_dirt = 1;
+	bh->b_meta = bh->b_dirt = 1;
 	dir->i_nlinks++;
 	dir->i_dirt = 1;
-	iput(dir);
 	iput(inode);
 	brelse(bh);
 	return 0;
@@ -632,119 +753,87 @@ static int empty_dir(struct m_inode * inode)
 	return 1;
 }
 
-int sys_rmdir(const char * name)
+int minix_rmdir(struct m_inode * dir, const char * name, int len)
 {
-	const char * basename;
-	int namelen;
-	struct m_inode * dir, * inode;
-	struct buffer_head * bh;
+	struct m_inode * inode;
+	struct buffer_head * bh, * head;
 	struct dir_entry * de;
+	int nr;
 
-	if (!(dir = dir_namei(name,&namelen,&basename, NULL)))
-		return -ENOENT;
-	if (!namelen) {
-		iput(dir);
-		return -ENOENT;
-	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		return -EPERM;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
-	if (!bh) {
-		iput(dir);
+	bh = find_entry(dir,name,len,&de,&nr);
+	if (!bh)
 		return -ENOENT;
-	}
 	if (!(inode = iget(dir->i_dev, de->inode))) {
-		iput(dir);
 		brelse(bh);
 		return -EPERM;
 	}
 	if ((dir->i_mode & S_ISVTX) && current->euid &&
 	    inode->i_uid != current->euid) {
-		iput(dir);
 		iput(inode);
 		brelse(bh);
 		return -EPERM;
 	}
 	if (inode->i_dev != dir->i_dev || inode->i_count>1) {
-		iput(dir);
 		iput(inode);
 		brelse(bh);
 		return -EPERM;
 	}
 	if (inode == dir) {	/* we may not delete ".", but "../dir" is ok */
 		iput(inode);
-		iput(dir);
 		brelse(bh);
 		return -EPERM;
 	}
 	if (!S_ISDIR(inode->i_mode)) {
 		iput(inode);
-		iput(dir);
 		brelse(bh);
 		return -ENOTDIR;
 	}
 	if (!empty_dir(inode)) {
 		iput(inode);
-		iput(dir);
 		brelse(bh);
 		return -ENOTEMPTY;
 	}
 	if (inode->i_nlinks != 2)
 		printk("empty directory has nlink!=2 (%d)",inode->i_nlinks);
+	head = dx_head(dir);
 	de->inode = 0;
-	bh->b_dirt = 1;
-	brelse(bh);
+	bh->b_meta = bh->b_dirt = 1;
 	inode->i_nlinks=0;
 	inode->i_dirt=1;
 	dir->i_nlinks--;
 	dir->i_ctime = dir->i_mtime = CURRENT_TIME;
 	dir->i_dirt=1;
-	iput(dir);
+	if (nr < dir->i_dir_free)
+		dir->i_dir_free = nr;
+	dx_delete(dir,head,nr,de->name);
+	brelse(bh);
 	iput(inode);
 	return 0;
 }
 
-int sys_unlink(const char * name)
+int minix_unlink(struct m_inode * dir, const char * name, int len)
 {
-	const char * basename;
-	int namelen;
-	struct m_inode * dir, * inode;
-	struct buffer_head * bh;
+	struct m_inode * inode;
+	struct buffer_head * bh, * head;
 	struct dir_entry * de;
+	int nr;
 
-	if (!(dir = dir_namei(name,&namelen,&basename, NULL)))
-		return -ENOENT;
-	if (!namelen) {
-		iput(dir);
-		return -ENOENT;
-	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		return -EPERM;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
-	if (!bh) {
-		iput(dir);
+	bh = find_entry(dir,name,len,&de,&nr);
+	if (!bh)
 		return -ENOENT;
-	}
 	if (!(inode = iget(dir->i_dev, de->inode))) {
-		iput(dir);
 		brelse(bh);
 		return -ENOENT;
 	}
 	if ((dir->i_mode & S_ISVTX) && !suser() &&
 	    current->euid != inode->i_uid &&
 	    current->euid != dir->i_uid) {
-		iput(dir);
 		iput(inode);
 		brelse(bh);
 		return -EPERM;
 	}
 	if (S_ISDIR(inode->i_mode)) {
 		iput(inode);
-		iput(dir);
 		brelse(bh);
 		return -EPERM;
 	}
@@ -753,142 +842,89 @@ int sys_unlink(const char * name)
 			inode->i_dev,inode->i_num,inode->i_nlinks);
 		inode->i_nlinks=1;
 	}
+	head = dx_head(dir);
 	de->inode = 0;
-	bh->b_dirt = 1;
+	bh->b_meta = bh->b_dirt = 1;
+	if (nr < dir->i_dir_free)
+		dir->i_dir_free = nr;
+	dx_delete(dir,head,nr,de->name);
 	brelse(bh);
 	inode->i_nlinks--;
 	inode->i_dirt = 1;
 	inode->i_ctime = CURRENT_TIME;
 	iput(inode);
-	iput(dir);
 	return 0;
 }
 
-int sys_symlink(const char * oldname, const char * newname)
+int minix_symlink(struct m_inode * dir, const char * name, int len,
+	const char * symname)
 {
 	struct dir_entry * de;
-	struct m_inode * dir, * inode;
+	struct m_inode * inode;
 	struct buffer_head * bh, * name_block;
-	const char * basename;
-	int namelen, i;
+	int i;
 	char c;
 
-	dir = dir_namei(newname,&namelen,&basename, NULL);
-	if (!dir)
-		return -EACCES;
-	if (!namelen) {
-		iput(dir);
-		return -EPERM;
-	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		return -EACCES;
-	}
-	if (!(inode = new_inode(dir->i_dev))) {
-		iput(dir);
+	if (!(inode = new_inode(dir->i_dev)))
 		return -ENOSPC;
-	}
 	inode->i_mode = S_IFLNK | (0777 & ~current->umask);
 	inode->i_dirt = 1;
 	if (!(inode->i_zone[0]=new_block(inode->i_dev))) {
-		iput(dir);
 		inode->i_nlinks--;
 		iput(inode);
 		return -ENOSPC;
 	}
 	inode->i_dirt = 1;
 	if (!(name_block=bread(inode->i_dev,inode->i_zone[0]))) {
-		iput(dir);
 		inode->i_nlinks--;
 		iput(inode);
 		return -ERROR;
 	}
 	i = 0;
-	while (i < 1023 && (c=get_fs_byte(oldname++)))
+	while (i < 1023 && (c=get_fs_byte(symname++)))
 		name_block->b_data[i++] = c;
 	name_block->b_data[i] = 0;
 	name_block->b_dirt = 1;
 	brelse(name_block);
 	inode->i_size = i;
 	inode->i_dirt = 1;
-	bh = find_entry(&dir,basename,namelen,&de);
+	bh = find_entry(dir,name,len,&de,NULL);
 	if (bh) {
 		inode->i_nlinks--;
 		iput(inode);
 		brelse(bh);
-		iput(dir);
 		return -EEXIST;
 	}
-	bh = add_entry(dir,basename,namelen,&de);
+	bh = add_entry(dir,name,len,&de,inode->i_num);
 	if (!bh) {
 		inode->i_nlinks--;
 		iput(inode);
-		iput(dir);
 		return -ENOSPC;
 	}
-	de->inode = inode->i_num;
-	bh->b_dirt = 1;
+	bh->b_meta = bh->b_dirt = 1;
 	brelse(bh);
-	iput(dir);
 	iput(inode);
 	return 0;
 }
 
-int sys_link(const char * oldname, const char * newname)
+int minix_link(struct m_inode * oldinode, struct m_inode * dir,
+	const char * name, int len)
 {
 	struct dir_entry * de;
-	struct m_inode * oldinode, * dir;
 	struct buffer_head * bh;
-	const char * basename;
-	int namelen;
 
-	oldinode=namei(oldname);
-	if (!oldinode)
-		return -ENOENT;
-	if (S_ISDIR(oldinode->i_mode)) {
-		iput(oldinode);
-		return -EPERM;
-	}
-	dir = dir_namei(newname,&namelen,&basename, NULL);
-	if (!dir) {
-		iput(oldinode);
-		return -EACCES;
-	}
-	if (!namelen) {
-		iput(oldinode);
-		iput(dir);
-		return -EPERM;
-	}
-	if (dir->i_dev != oldinode->i_dev) {
-		iput(dir);
-		iput(oldinode);
-		return -EXDEV;
-	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		iput(oldinode);
-		return -EACCES;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
+	bh = find_entry(dir,name,len,&de,NULL);
 	if (bh) {
 		brelse(bh);
-		iput(dir);
-		iput(oldinode);
 		return -EEXIST;
 	}
-	bh = add_entry(dir,basename,namelen,&de);
-	if (!bh) {
-		iput(dir);
-		iput(oldinode);
+	bh = add_entry(dir,name,len,&de,oldinode->i_num);
+	if (!bh)
 		return -ENOSPC;
-	}
-	de->inode = oldinode->i_num;
-	bh->b_dirt = 1;
+	bh->b_meta = bh->b_dirt = 1;
 	brelse(bh);
-	iput(dir);
 	oldinode->i_nlinks++;
 	oldinode->i_ctime = CURRENT_TIME;
 	oldinode->i_dirt = 1;
-	iput(oldinode);
 	return 0;
 }
@@ -4,29 +4,51 @@
  *  (C) 1991  Linus Torvalds
  */
 
+#include <errno.h>
+
 #include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/locks.h>
+#include <asm/system.h>
 
 #include <sys/stat.h>
 
+/* unlinked files bigger than this are freed by truncd, if it runs */
+#define FREE_LATER_SIZE	(64*BLOCK_SIZE)
+
+static struct task_struct * truncd_wait = NULL;
+static int truncd_running = 0;
+static int truncd_pending = 0;
+
+/*
+ * Start reading the (indirect) blocks in 'p' so that they don't have
+ * to be waited for one at a time.
+ */
+static void read_ahead(int dev, unsigned short * p, int nr)
+{
+	struct buffer_head * bh;
+
+	for ( ; nr-- > 0 ; p++) {
+		if (!*p || !(bh = getblk(dev,*p)))
+			continue;
+		if (!bh->b_uptodate)
+			ll_rw_block(READA,bh);
+		bh->b_count--;
+	}
+}
+
 static int free_ind(int dev,int block)
 {
 	struct buffer_head * bh;
-	unsigned short * p;
-	int i;
 	int block_busy;
 
 	if (!block)
 		return 1;
 	block_busy = 0;
 	if (bh=bread(dev,block)) {
-		p = (unsigned short *) bh->b_data;
-		for (i=0;i<512;i++,p++)
-			if (*p)
-				if (free_block(dev,*p)) {
-					*p = 0;
-					bh->b_dirt = 1;
-				} else
-					block_busy = 1;
+		if (!free_blocks(dev,(unsigned short *) bh->b_data,512))
+			block_busy = 1;
+		bh->b_meta = bh->b_dirt = 1;
 		brelse(bh);
 	}
 	if (block_busy)
@@ -47,11 +69,12 @@ static int free_dind(int dev,int block)
 	block_busy = 0;
 	if (bh=bread(dev,block)) {
 		p = (unsigned short *) bh->b_data;
+		read_ahead(dev,p,512);
 		for (i=0;i<512;i++,p++)
 			if (*p)
 				if (free_ind(dev,*p)) {
 					*p = 0;
-					bh->b_dirt = 1;
+					bh->b_meta = bh->b_dirt = 1;
 				} else
 					block_busy = 1;
 		brelse(bh);
@@ -64,21 +87,18 @@ static int free_dind(int dev,int block)
 
 void truncate(struct m_inode * inode)
 {
-	int i;
 	int block_busy;
 
 	if (!(S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode) ||
 	     S_ISLNK(inode->i_mode)))
 		return;
+	wait_on_defrag(inode);
+	invalidate_cache(inode->i_dev,inode->i_num);
 repeat:
 	block_busy = 0;
-	for (i=0;i<7;i++)
-		if (inode->i_zone[i]) {
-			if (free_block(inode->i_dev,inode->i_zone[i]))
-				inode->i_zone[i]=0;
-			else
-				block_busy = 1;
-		}
+	read_ahead(inode->i_dev,inode->i_zone+7,2);
+	if (!free_blocks(inode->i_dev,inode->i_zone,7))
+		block_busy = 1;
 	if (free_ind(inode->i_dev,inode->i_zone[7]))
 		inode->i_zone[7] = 0;
 	else
@@ -97,3 +117,44 @@ repeat:
 	inode->i_mtime = inode->i_ctime = CURRENT_TIME;
 }
 
+/*
+ * free_later() is called by iput() for the last reference to an
+ * unlinked file. Big ones are left to truncd, which then owns that
+ * reference, so that unlink() doesn't have to wait for the frees.
+ */
+int free_later(struct m_inode * inode)
+{
+	if (!truncd_running || inode->i_free_later ||
+	    !S_ISREG(inode->i_mode) || inode->i_size < FREE_LATER_SIZE)
+		return 0;
+	inode->i_free_later = 1;
+	truncd_pending++;
+	wake_up(&truncd_wait);
+	return 1;
+}
+
+/*
+ * truncd: started by init through kdaemon(), never returns.
+ */
+int truncate_daemon(void)
+{
+	struct m_inode * inode;
+
+	if (truncd_running)
+		return -EBUSY;
+	truncd_running = 1;
+	for (;;) {
+		cli();
+		while (!truncd_pending)
+			sleep_on(&truncd_wait);
+		sti();
+		for (inode = inode_table ; inode < NR_INODE+inode_table ; inode++)
+			if (inode->i_free_later) {
+				truncd_pending--;
+				journal_start();
+				truncate(inode);
+				journal_stop();
+				iput(inode);
+			}
+	}
+}
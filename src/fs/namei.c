@@ -0,0 +1,510 @@
+/*
+ *  linux/fs/namei.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * Some corrections by tytso.
+ */
+
+/*
+ * The pathname walk and the system calls that change directories.
+ * Everything that depends on how a directory is stored is done by
+ * the inode operations of the filesystem it lives on.
+ */
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <asm/segment.h>
+
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <const.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#define ACC_MODE(x) ("\004\002\006\377"[(x)&O_ACCMODE])
+
+#define MAY_EXEC 1
+#define MAY_WRITE 2
+#define MAY_READ 4
+
+/*
+ *	permission()
+ *
+ * is used to check for read/write/execute permissions on a file.
+ * I don't know if we should look at just the euid or both euid and
+ * uid, but that should be easily changed.
+ */
+static int permission(struct m_inode * inode,int mask)
+{
+	int mode = inode->i_mode;
+
+/* special case: not even root can read/write a deleted file */
+	if (inode->i_dev && !inode->i_nlinks)
+		return 0;
+	else if (current->euid==inode->i_uid)
+		mode >>= 6;
+	else if (in_group_p(inode->i_gid))
+		mode >>= 3;
+	if (((mode & mask & 0007) == mask) || suser())
+		return 1;
+	return 0;
+}
+
+/*
+ *	lookup()
+ *
+ * looks up a name in a directory, and takes care of the few special
+ * cases due to '..'-traversal over a pseudo-root and a mount point:
+ * 'dir' may be exchanged for another directory, which is why we get
+ * a pointer to it.
+ */
+static int lookup(struct m_inode ** dir, const char * name, int len,
+	struct m_inode ** result)
+{
+	struct super_block * sb;
+
+	*result = NULL;
+	if (len==2 && get_fs_byte(name)=='.' && get_fs_byte(name+1)=='.') {
+/* '..' in a pseudo-root results in a faked '.' (just change namelen) */
+		if ((*dir) == current->root)
+			len = 1;
+		else if ((*dir)->i_num == ROOT_INO) {
+/* '..' over a mount-point results in 'dir' being exchanged for the mounted
+   directory-inode. NOTE! We set mounted, so that we can iput the new dir */
+			sb=get_super((*dir)->i_dev);
+			if (sb->s_imount) {
+				iput(*dir);
+				(*dir)=sb->s_imount;
+				(*dir)->i_count++;
+			}
+		}
+	}
+	if (!(*dir)->i_op || !(*dir)->i_op->lookup)
+		return -ENOTDIR;
+	return (*dir)->i_op->lookup(*dir,name,len,result);
+}
+
+static struct m_inode * follow_link(struct m_inode * dir, struct m_inode * inode)
+{
+	if (!dir) {
+		dir = current->root;
+		dir->i_count++;
+	}
+	if (!inode) {
+		iput(dir);
+		return NULL;
+	}
+	if (!S_ISLNK(inode->i_mode)) {
+		iput(dir);
+		return inode;
+	}
+	if (!inode->i_op || !inode->i_op->follow_link) {
+		iput(dir);
+		iput(inode);
+		return NULL;
+	}
+	return inode->i_op->follow_link(dir,inode);
+}
+
+/*
+ *	get_dir()
+ *
+ * Getdir traverses the pathname until it hits the topmost directory.
+ * It returns NULL on failure.
+ */
+static struct m_inode * get_dir(const char * pathname, struct m_inode * inode)
+{
+	char c;
+	const char * thisname;
+	int namelen;
+	struct m_inode * dir;
+
+	if (!inode) {
+		inode = current->pwd;
+		inode->i_count++;
+	}
+	if ((c=get_fs_byte(pathname))=='/') {
+		iput(inode);
+		inode = current->root;
+		pathname++;
+		inode->i_count++;
+	}
+	while (1) {
+		thisname = pathname;
+		if (!S_ISDIR(inode->i_mode) || !permission(inode,MAY_EXEC)) {
+			iput(inode);
+			return NULL;
+		}
+		for(namelen=0;(c=get_fs_byte(pathname++))&&(c!='/');namelen++)
+			/* nothing */ ;
+		if (!c)
+			return inode;
+		dir = inode;
+		if (lookup(&dir,thisname,namelen,&inode)) {
+			iput(dir);
+			return NULL;
+		}
+		if (!(inode = follow_link(dir,inode)))
+			return NULL;
+	}
+}
+
+/*
+ *	dir_namei()
+ *
+ * dir_namei() returns the inode of the directory of the
+ * specified name, and the name within that directory.
+ */
+static struct m_inode * dir_namei(const char * pathname,
+	int * namelen, const char ** name, struct m_inode * base)
+{
+	char c;
+	const char * basename;
+	struct m_inode * dir;
+
+	if (!(dir = get_dir(pathname,base)))
+		return NULL;
+	basename = pathname;
+	while (c=get_fs_byte(pathname++))
+		if (c=='/')
+			basename=pathname;
+	*namelen = pathname-basename-1;
+	*name = basename;
+	return dir;
+}
+
+struct m_inode * _namei(const char * pathname, struct m_inode * base,
+	int follow_links)
+{
+	const char * basename;
+	int namelen;
+	struct m_inode * inode;
+
+	if (!(base = dir_namei(pathname,&namelen,&basename,base)))
+		return NULL;
+	if (!namelen)			/* special case: '/usr/' etc */
+		return base;
+	if (lookup(&base,basename,namelen,&inode)) {
+		iput(base);
+		return NULL;
+	}
+	if (follow_links)
+		inode = follow_link(base,inode);
+	else
+		iput(base);
+	if (inode)
+		update_atime(inode);
+	return inode;
+}
+
+struct m_inode * lnamei(const char * pathname)
+{
+	return _namei(pathname, NULL, 0);
+}
+
+/*
+ *	namei()
+ *
+ * is used by most simple commands to get the inode of a specified name.
+ * Open, link etc use their own routines, but this is enough for things
+ * like 'chmod' etc.
+ */
+struct m_inode * namei(const char * pathname)
+{
+	return _namei(pathname,NULL,1);
+}
+
+/*
+ *	open_namei()
+ *
+ * namei for open - this is in fact almost the whole open-routine.
+ */
+static int do_open_namei(const char * pathname, int flag, int mode,
+	struct m_inode ** res_inode)
+{
+	const char * basename;
+	int namelen,error;
+	struct m_inode * dir, *inode;
+
+	if ((flag & O_TRUNC) && !(flag & O_ACCMODE))
+		flag |= O_WRONLY;
+	mode &= 0777 & ~current->umask;
+	mode |= I_REGULAR;
+	if (!(dir = dir_namei(pathname,&namelen,&basename,NULL)))
+		return -ENOENT;
+	if (!namelen) {			/* special case: '/usr/' etc */
+		if (!(flag & (O_ACCMODE|O_CREAT|O_TRUNC))) {
+			*res_inode=dir;
+			return 0;
+		}
+		iput(dir);
+		return -EISDIR;
+	}
+	if (lookup(&dir,basename,namelen,&inode)) {
+		if (!(flag & O_CREAT)) {
+			iput(dir);
+			return -ENOENT;
+		}
+		if (IS_RDONLY(dir)) {
+			iput(dir);
+			return -EROFS;
+		}
+		if (!permission(dir,MAY_WRITE)) {
+			iput(dir);
+			return -EACCES;
+		}
+		if (!dir->i_op->create) {
+			iput(dir);
+			return -EPERM;
+		}
+		error = dir->i_op->create(dir,basename,namelen,mode,res_inode);
+		if (!error)
+			fsnotify(dir,IN_CREATE,basename,namelen);
+		iput(dir);
+		return error;
+	}
+	if (flag & O_EXCL) {
+		iput(inode);
+		iput(dir);
+		return -EEXIST;
+	}
+	if (!(inode = follow_link(dir,inode)))
+		return -EACCES;
+	if ((S_ISDIR(inode->i_mode) && (flag & O_ACCMODE)) ||
+	    !permission(inode,ACC_MODE(flag))) {
+		iput(inode);
+		return -EPERM;
+	}
+	if (IS_RDONLY(inode) && (ACC_MODE(flag) & MAY_WRITE) &&
+	    (S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode))) {
+		iput(inode);
+		return -EROFS;
+	}
+	update_atime(inode);
+	if ((flag & O_TRUNC) && inode->i_op && inode->i_op->truncate) {
+		inode->i_op->truncate(inode);
+		fsnotify(inode,IN_MODIFY,NULL,0);
+	}
+	*res_inode = inode;
+	return 0;
+}
+
+/*
+ * Everything that changes a directory is one journal transaction: the
+ * real work is done in the do_xxx() versions.
+ */
+int open_namei(const char * pathname, int flag, int mode,
+	struct m_inode ** res_inode)
+{
+	int error;
+
+	if (!(flag & (O_CREAT|O_TRUNC)))
+		return do_open_namei(pathname,flag,mode,res_inode);
+	journal_start();
+	error = do_open_namei(pathname,flag,mode,res_inode);
+	journal_stop();
+	return error;
+}
+
+/*
+ * Gets the directory 'pathname' is to be created in (or removed from),
+ * and checks that we may write it.
+ */
+static int write_dir(const char * pathname, struct m_inode ** res_dir,
+	int * namelen, const char ** basename)
+{
+	struct m_inode * dir;
+
+	if (!(dir = dir_namei(pathname,namelen,basename,NULL)))
+		return -ENOENT;
+	if (!*namelen) {
+		iput(dir);
+		return -ENOENT;
+	}
+	if (IS_RDONLY(dir)) {
+		iput(dir);
+		return -EROFS;
+	}
+	if (!permission(dir,MAY_WRITE)) {
+		iput(dir);
+		return -EPERM;
+	}
+	*res_dir = dir;
+	return 0;
+}
+
+int sys_mknod(const char * filename, int mode, int dev)
+{
+	const char * basename;
+	int namelen, error;
+	struct m_inode * dir;
+
+	if (!suser())
+		return -EPERM;
+	if (error = write_dir(filename,&dir,&namelen,&basename))
+		return error;
+	if (!dir->i_op->mknod) {
+		iput(dir);
+		return -EPERM;
+	}
+	journal_start();
+	error = dir->i_op->mknod(dir,basename,namelen,mode,dev);
+	journal_stop();
+	if (!error)
+		fsnotify(dir,IN_CREATE,basename,namelen);
+	iput(dir);
+	return error;
+}
+
+int sys_mkdir(const char * pathname, int mode)
+{
+	const char * basename;
+	int namelen, error;
+	struct m_inode * dir;
+
+	if (error = write_dir(pathname,&dir,&namelen,&basename))
+		return error;
+	if (!dir->i_op->mkdir) {
+		iput(dir);
+		return -EPERM;
+	}
+	journal_start();
+	error = dir->i_op->mkdir(dir,basename,namelen,mode);
+	journal_stop();
+	if (!error)
+		fsnotify(dir,IN_CREATE,basename,namelen);
+	iput(dir);
+	return error;
+}
+
+int sys_rmdir(const char * name)
+{
+	const char * basename;
+	int namelen, error;
+	struct m_inode * dir;
+
+	if (error = write_dir(name,&dir,&namelen,&basename))
+		return error;
+	if (!dir->i_op->rmdir) {
+		iput(dir);
+		return -EPERM;
+	}
+	journal_start();
+	error = dir->i_op->rmdir(dir,basename,namelen);
+	journal_stop();
+	if (!error)
+		fsnotify(dir,IN_DELETE,basename,namelen);
+	iput(dir);
+	return error;
+}
+
+int sys_unlink(const char * name)
+{
+	const char * basename;
+	int namelen, error;
+	struct m_inode * dir;
+
+	if (error = write_dir(name,&dir,&namelen,&basename))
+		return error;
+	if (!dir->i_op->unlink) {
+		iput(dir);
+		return -EPERM;
+	}
+	journal_start();
+	error = dir->i_op->unlink(dir,basename,namelen);
+	journal_stop();
+	if (!error)
+		fsnotify(dir,IN_DELETE,basename,namelen);
+	iput(dir);
+	return error;
+}
+
+int sys_symlink(const char * oldname, const char * newname)
+{
+	const char * basename;
+	int namelen, error;
+	struct m_inode * dir;
+
+	if (!(dir = dir_namei(newname,&namelen,&basename,NULL)))
+		return -EACCES;
+	if (!namelen) {
+		iput(dir);
+		return -EPERM;
+	}
+	if (IS_RDONLY(dir)) {
+		iput(dir);
+		return -EROFS;
+	}
+	if (!permission(dir,MAY_WRITE)) {
+		iput(dir);
+		return -EACCES;
+	}
+	if (!dir->i_op->symlink) {
+		iput(dir);
+		return -EPERM;
+	}
+	journal_start();
+	error = dir->i_op->symlink(dir,basename,namelen,oldname);
+	journal_stop();
+	if (!error)
+		fsnotify(dir,IN_CREATE,basename,namelen);
+	iput(dir);
+	return error;
+}
+
+int sys_link(const char * oldname, const char * newname)
+{
+	struct m_inode * oldinode, * dir;
+	const char * basename;
+	int namelen, error;
+
+	oldinode=namei(oldname);
+	if (!oldinode)
+		return -ENOENT;
+	if (S_ISDIR(oldinode->i_mode)) {
+		iput(oldinode);
+		return -EPERM;
+	}
+	dir = dir_namei(newname,&namelen,&basename, NULL);
+	if (!dir) {
+		iput(oldinode);
+		return -EACCES;
+	}
+	if (!namelen) {
+		iput(oldinode);
+		iput(dir);
+		return -EPERM;
+	}
+	if (dir->i_dev != oldinode->i_dev) {
+		iput(dir);
+		iput(oldinode);
+		return -EXDEV;
+	}
+	if (IS_RDONLY(dir)) {
+		iput(dir);
+		iput(oldinode);
+		return -EROFS;
+	}
+	if (!permission(dir,MAY_WRITE)) {
+		iput(dir);
+		iput(oldinode);
+		return -EACCES;
+	}
+	if (!dir->i_op->link) {
+		iput(dir);
+		iput(oldinode);
+		return -EPERM;
+	}
+	journal_start();
+	error = dir->i_op->link(oldinode,dir,basename,namelen);
+	journal_stop();
+	if (!error)
+		fsnotify(dir,IN_CREATE,basename,namelen);
+	iput(dir);
+	iput(oldinode);
+	return error;
+}
@@ -0,0 +1,229 @@
+/*
+ *  linux/fs/notify.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * inotify: a daemon gets an fd that becomes readable when something
+ * happens to the inodes it watches, instead of stat()ing them over and
+ * over. The fd is a pipe inode (so select() and close() need nothing
+ * new) with i_notify set: the events are queued in the pipe page. A
+ * watch holds a reference to its inode, so i_watched stays put and is
+ * all fsnotify() has to look at when nobody is watching.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/inotify.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/segment.h>
+
+#define NR_WATCHES	64
+#define EV_SIZE		(sizeof (struct inotify_event))
+
+static struct watch {
+	struct m_inode * w_inode;	/* NULL if free */
+	struct m_inode * w_notify;
+	unsigned long w_mask;
+} watch_table[NR_WATCHES];
+
+#define wd_nr(w) ((w) - watch_table + 1)
+
+static void queue_event(struct m_inode * notify, struct inotify_event * ev)
+{
+	char * page = (char *) notify->i_size;
+	int i, head, last;
+
+	if ((PAGE_SIZE-1) - PIPE_SIZE(*notify) < 2*EV_SIZE) {
+		if ((PAGE_SIZE-1) - PIPE_SIZE(*notify) < EV_SIZE)
+			return;
+		ev->wd = -1;
+		ev->mask = IN_Q_OVERFLOW;
+		memset(ev->name,0,sizeof (ev->name));
+	}
+/* the same event again, still unread: once is enough */
+	if (PIPE_SIZE(*notify) >= EV_SIZE) {
+		last = (PIPE_HEAD(*notify) - EV_SIZE) & (PAGE_SIZE-1);
+		for (i = 0 ; i < EV_SIZE ; i++)
+			if (page[(last+i) & (PAGE_SIZE-1)] != ((char *) ev)[i])
+				break;
+		if (i == EV_SIZE)
+			return;
+	}
+	head = PIPE_HEAD(*notify);
+	for (i = 0 ; i < EV_SIZE ; i++)
+		page[(head+i) & (PAGE_SIZE-1)] = ((char *) ev)[i];
+	PIPE_HEAD(*notify) = (head + EV_SIZE) & (PAGE_SIZE-1);
+	wake_up(&PIPE_READ_WAIT(*notify));
+}
+
+/*
+ * Something happened to 'inode'. For IN_CREATE/IN_DELETE 'name' is
+ * the entry in the directory, in user space like all pathnames.
+ */
+void fsnotify(struct m_inode * inode, int mask, const char * name, int len)
+{
+	struct inotify_event ev;
+	struct watch * w;
+	int i;
+
+	if (!inode || !inode->i_watched)
+		return;
+	for (w = watch_table ; w < watch_table+NR_WATCHES ; w++) {
+		if (w->w_inode != inode || !(w->w_mask & mask))
+			continue;
+		ev.wd = wd_nr(w);
+		ev.mask = mask;
+		for (i = 0 ; i < sizeof (ev.name) ; i++)
+			ev.name[i] = (i < len && i < NAME_LEN) ?
+				get_fs_byte(name+i) : 0;
+		queue_event(w->w_notify,&ev);
+	}
+}
+
+static void drop_watch(struct watch * w)
+{
+	struct m_inode * inode = w->w_inode;
+
+	w->w_inode = w->w_notify = NULL;
+	inode->i_watched--;
+	iput(inode);
+}
+
+/*
+ * The last close of an inotify fd.
+ */
+void notify_release(struct m_inode * notify)
+{
+	struct watch * w;
+
+	for (w = watch_table ; w < watch_table+NR_WATCHES ; w++)
+		if (w->w_inode && w->w_notify == notify)
+			drop_watch(w);
+}
+
+int read_notify(struct m_inode * inode, struct file * filp,
+	char * buf, int count)
+{
+	int i, read = 0;
+
+	if (count < EV_SIZE)
+		return -EINVAL;
+	while (PIPE_EMPTY(*inode)) {
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (current->signal & ~current->blocked)
+			return -ERESTARTSYS;
+		interruptible_sleep_on(&PIPE_READ_WAIT(*inode));
+	}
+	while (count - read >= EV_SIZE && PIPE_SIZE(*inode) >= EV_SIZE) {
+		for (i = 0 ; i < EV_SIZE ; i++) {
+			put_fs_byte(((char *) inode->i_size)[PIPE_TAIL(*inode)],
+				buf++);
+			PIPE_TAIL(*inode) = (PIPE_TAIL(*inode)+1) & (PAGE_SIZE-1);
+		}
+		read += EV_SIZE;
+	}
+	return read;
+}
+
+static struct m_inode * get_notify(unsigned int fd)
+{
+	struct file * file;
+
+	if (fd >= NR_OPEN || !(file = current->filp[fd]) ||
+	    !file->f_inode || !file->f_inode->i_notify)
+		return NULL;
+	return file->f_inode;
+}
+
+int sys_inotify_init(void)
+{
+	struct m_inode * inode;
+	struct file * f;
+	int fd, i;
+
+	for (fd = 0 ; fd < NR_OPEN ; fd++)
+		if (!current->filp[fd])
+			break;
+	if (fd >= NR_OPEN)
+		return -EMFILE;
+	for (i = 0, f = file_table ; i < NR_FILE ; i++, f++)
+		if (!f->f_count)
+			break;
+	if (i >= NR_FILE)
+		return -ENFILE;
+	if (!(inode = get_pipe_inode()))
+		return -ENOMEM;
+	inode->i_count = 1;		/* no writers */
+	inode->i_notify = 1;
+	(current->filp[fd] = f)->f_count++;
+	current->close_on_exec &= ~(1<<fd);
+	f->f_inode = inode;
+	f->f_mode = 1;			/* read */
+	f->f_flags = 0;
+	f->f_pos = 0;
+	return fd;
+}
+
+int sys_inotify_add_watch(unsigned int fd, const char * pathname,
+	unsigned long mask)
+{
+	struct m_inode * notify, * inode;
+	struct watch * w, * free = NULL;
+
+	if (!(notify = get_notify(fd)))
+		return -EBADF;
+	if (!(mask &= IN_ALL_EVENTS))
+		return -EINVAL;
+	if (!(inode = namei(pathname)))
+		return -ENOENT;
+	for (w = watch_table ; w < watch_table+NR_WATCHES ; w++) {
+		if (!w->w_inode) {
+			if (!free)
+				free = w;
+			continue;
+		}
+		if (w->w_inode == inode && w->w_notify == notify) {
+			w->w_mask = mask;
+			iput(inode);
+			return wd_nr(w);
+		}
+	}
+	if (!free) {
+		iput(inode);
+		return -ENOSPC;
+	}
+	free->w_inode = inode;		/* keeps our reference */
+	free->w_notify = notify;
+	free->w_mask = mask;
+	inode->i_watched++;
+	return wd_nr(free);
+}
+
+int sys_inotify_rm_watch(unsigned int fd, int wd)
+{
+	struct m_inode * notify;
+	struct inotify_event ev;
+	struct watch * w;
+
+	if (!(notify = get_notify(fd)))
+		return -EBADF;
+	if (wd < 1 || wd > NR_WATCHES)
+		return -EINVAL;
+	w = watch_table + wd - 1;
+	if (!w->w_inode || w->w_notify != notify)
+		return -EINVAL;
+	drop_watch(w);
+	ev.wd = wd;
+	ev.mask = IN_IGNORED;
+	memset(ev.name,0,sizeof (ev.name));
+	queue_event(notify,&ev);
+	return 0;
+}
@@ -10,6 +10,7 @@
 #include <sys/types.h>
 #include <utime.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
 
 #include <linux/sched.h>
 #include <linux/tty.h>
@@ -19,7 +20,46 @@
 
 int sys_ustat(int dev, struct ustat * ubuf)
 {
-	return -ENOSYS;
+	struct super_block * sb;
+	struct ustat tmp;
+	int i;
+
+	if (!(sb = get_super(dev)))
+		return -EINVAL;
+	verify_area(ubuf,sizeof (struct ustat));
+	memset(&tmp,0,sizeof (tmp));
+	tmp.f_tfree = sb->s_free_zones << sb->s_log_zone_size;
+	tmp.f_tinode = sb->s_free_inodes;
+	for (i=0 ; i<sizeof (tmp) ; i++)
+		put_fs_byte(((char *) &tmp)[i],i + (char *) ubuf);
+	return 0;
+}
+
+int sys_statfs(const char * filename, struct statfs * buf)
+{
+	struct m_inode * inode;
+	struct super_block * sb;
+	struct statfs tmp;
+	int i;
+
+	if (!(inode=namei(filename)))
+		return -ENOENT;
+	sb = get_super(inode->i_dev);
+	iput(inode);
+	if (!sb)
+		return -EINVAL;
+	verify_area(buf,sizeof (struct statfs));
+	tmp.f_type = sb->s_magic;
+	tmp.f_bsize = BLOCK_SIZE;
+	tmp.f_blocks = (sb->s_nzones - sb->s_firstdatazone) << sb->s_log_zone_size;
+	tmp.f_bfree = sb->s_free_zones << sb->s_log_zone_size;
+	tmp.f_bavail = tmp.f_bfree;
+	tmp.f_files = sb->s_ninodes;
+	tmp.f_ffree = sb->s_free_inodes;
+	tmp.f_namelen = NAME_LEN;
+	for (i=0 ; i<sizeof (tmp) ; i++)
+		put_fs_byte(((char *) &tmp)[i],i + (char *) buf);
+	return 0;
 }
 
 int sys_utime(char * filename, struct utimbuf * times)
@@ -29,6 +69,10 @@ int sys_utime(char * filename, struct utimbuf * times)
 
 	if (!(inode=namei(filename)))
 		return -ENOENT;
+	if (IS_RDONLY(inode)) {
+		iput(inode);
+		return -EROFS;
+	}
 	if (times) {
 		actime = get_fs_long((unsigned long *) &times->actime);
 		modtime = get_fs_long((unsigned long *) &times->modtime);
@@ -37,6 +81,7 @@ int sys_utime(char * filename, struct utimbuf * times)
 	inode->i_atime = actime;
 	inode->i_mtime = modtime;
 	inode->i_dirt = 1;
+	fsnotify(inode,IN_ATTRIB,NULL,0);
 	iput(inode);
 	return 0;
 }
@@ -109,12 +154,17 @@ int sys_chmod(const char * filename,int mode)
 
 	if (!(inode=namei(filename)))
 		return -ENOENT;
+	if (IS_RDONLY(inode)) {
+		iput(inode);
+		return -EROFS;
+	}
 	if ((current->euid != inode->i_uid) && !suser()) {
 		iput(inode);
 		return -EACCES;
 	}
 	inode->i_mode = (mode & 07777) | (inode->i_mode & ~07777);
 	inode->i_dirt = 1;
+	fsnotify(inode,IN_ATTRIB,NULL,0);
 	iput(inode);
 	return 0;
 }
@@ -125,6 +175,10 @@ int sys_chown(const char * filename,int uid,int gid)
 
 	if (!(inode=namei(filename)))
 		return -ENOENT;
+	if (IS_RDONLY(inode)) {
+		iput(inode);
+		return -EROFS;
+	}
 	if (!suser()) {
 		iput(inode);
 		return -EACCES;
@@ -132,6 +186,7 @@ int sys_chown(const char * filename,int uid,int gid)
 	inode->i_uid=uid;
 	inode->i_gid=gid;
 	inode->i_dirt=1;
+	fsnotify(inode,IN_ATTRIB,NULL,0);
 	iput(inode);
 	return 0;
 }
@@ -11,16 +11,13 @@
 #include <linux/kernel.h>
 #include <linux/sched.h>
 #include <asm/segment.h>
+#include <sys/inotify.h>
 
 extern int rw_char(int rw,int dev, char * buf, int count, off_t * pos);
 extern int read_pipe(struct m_inode * inode, char * buf, int count);
 extern int write_pipe(struct m_inode * inode, char * buf, int count);
-extern int block_read(int dev, off_t * pos, char * buf, int count);
-extern int block_write(int dev, off_t * pos, char * buf, int count);
-extern int file_read(struct m_inode * inode, struct file * filp,
-		char * buf, int count);
-extern int file_write(struct m_inode * inode, struct file * filp,
-		char * buf, int count);
+extern int block_read(int dev, off_t * pos, char * buf, int count, int flags);
+extern int block_write(int dev, off_t * pos, char * buf, int count, int flags);
 
 int sys_lseek(unsigned int fd,off_t offset, int origin)
 {
@@ -63,18 +60,21 @@ int sys_read(unsigned int fd,char * buf,int count)
 		return 0;
 	verify_area(buf,count);
 	inode = file->f_inode;
+	if (inode->i_notify)
+		return read_notify(inode,file,buf,count);
 	if (inode->i_pipe)
 		return (file->f_mode&1)?read_pipe(inode,buf,count):-EIO;
 	if (S_ISCHR(inode->i_mode))
 		return rw_char(READ,inode->i_zone[0],buf,count,&file->f_pos);
 	if (S_ISBLK(inode->i_mode))
-		return block_read(inode->i_zone[0],&file->f_pos,buf,count);
+		return block_read(inode->i_zone[0],&file->f_pos,buf,count,
+			file->f_flags);
 	if (S_ISDIR(inode->i_mode) || S_ISREG(inode->i_mode)) {
 		if (count+file->f_pos > inode->i_size)
 			count = inode->i_size - file->f_pos;
 		if (count<=0)
 			return 0;
-		return file_read(inode,file,buf,count);
+		return inode->i_op->default_file_ops->read(inode,file,buf,count);
 	}
 	printk("(Read)inode->i_mode=%06o\n\r",inode->i_mode);
 	return -EINVAL;
@@ -95,9 +95,14 @@ int sys_write(unsigned int fd,char * buf,int count)
 	if (S_ISCHR(inode->i_mode))
 		return rw_char(WRITE,inode->i_zone[0],buf,count,&file->f_pos);
 	if (S_ISBLK(inode->i_mode))
-		return block_write(inode->i_zone[0],&file->f_pos,buf,count);
-	if (S_ISREG(inode->i_mode))
-		return file_write(inode,file,buf,count);
+		return block_write(inode->i_zone[0],&file->f_pos,buf,count,
+			file->f_flags);
+	if (S_ISREG(inode->i_mode)) {
+		count = inode->i_op->default_file_ops->write(inode,file,buf,count);
+		if (count > 0)
+			fsnotify(inode,IN_MODIFY,NULL,0);
+		return count;
+	}
 	printk("(Write)inode->i_mode=%06o\n\r",inode->i_mode);
 	return -EINVAL;
 }
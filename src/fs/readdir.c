@@ -0,0 +1,89 @@
+/*
+ *  linux/fs/readdir.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/dirent.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <asm/segment.h>
+
+#define DIRENT_NAME	((long) ((struct dirent *) 0)->d_name)
+
+extern void cp_stat(struct m_inode * inode, struct stat * statbuf);
+
+/*
+ * Copies one entry of 'dir' out to the user. Returns the size used,
+ * 0 if it doesn't fit in 'count' bytes.
+ */
+int put_dirent(struct m_inode * dir, struct dir_entry * de, off_t off,
+	char * buf, int count, int flags)
+{
+	struct m_inode * inode;
+	struct dirent * d;
+	int i, len, size;
+
+	for (len = 0 ; len < NAME_LEN && de->name[len] ; len++)
+		/* nothing */ ;
+	size = (DIRENT_NAME + len + 1 + 3) & ~3;
+	if (flags & READDIR_PLUS)
+		size += sizeof (struct stat);
+	if (size > count)
+		return 0;
+	if (flags & READDIR_PLUS) {
+		if (!(inode = iget(dir->i_dev,de->inode)))
+			return -EIO;
+		cp_stat(inode,(struct stat *) buf);
+		iput(inode);
+		d = &((struct dirent_plus *) buf)->d_dirent;
+	} else
+		d = (struct dirent *) buf;
+	put_fs_long(de->inode,(unsigned long *) &d->d_ino);
+	put_fs_long(off,(unsigned long *) &d->d_off);
+	put_fs_word(size,(short *) &d->d_reclen);
+	for (i = 0 ; i < len ; i++)
+		put_fs_byte(de->name[i],i + d->d_name);
+	put_fs_byte(0,i + d->d_name);
+	return size;
+}
+
+/*
+ * readdir() fills 'buf' with as many directory entries as fit, each
+ * one a struct dirent cut down to d_reclen bytes (READDIR_PLUS puts
+ * the entry's struct stat in front of it). It returns the number of
+ * bytes used, 0 at the end of the directory.
+ */
+static int do_readdir(unsigned int fd, char * buf, int count, int flags)
+{
+	struct file * file;
+	struct m_inode * inode;
+
+	if (fd >= NR_OPEN || !(file=current->filp[fd]) ||
+	    !(inode=file->f_inode))
+		return -EBADF;
+	if (!S_ISDIR(inode->i_mode))
+		return -ENOTDIR;
+	if (count <= 0 || (flags & ~READDIR_PLUS))
+		return -EINVAL;
+	if (!inode->i_op->default_file_ops->readdir)
+		return -ENOTDIR;
+	verify_area(buf,count);
+	return inode->i_op->default_file_ops->readdir(inode,file,buf,count,flags);
+}
+
+/*
+ * There are four arguments: they are passed in an array, as for mmap().
+ */
+int sys_readdir(unsigned long * buffer)
+{
+	unsigned long a[4];
+	int i;
+
+	for (i = 0 ; i < 4 ; i++)
+		a[i] = get_fs_long(buffer+i);
+	return do_readdir(a[0],(char *) a[1],a[2],a[3]);
+}
@@ -143,7 +143,7 @@ static int check_ex(select_table * wait, struct m_inode * inode)
 			return 0;
 		else
 			return 0;
-	else if (inode->i_pipe)
+	else if (inode->i_pipe && !inode->i_notify)
 		if (inode->i_count < 2)
 			return 1;
 		else
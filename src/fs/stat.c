@@ -12,7 +12,7 @@
 #include <linux/kernel.h>
 #include <asm/segment.h>
 
-static void cp_stat(struct m_inode * inode, struct stat * statbuf)
+void cp_stat(struct m_inode * inode, struct stat * statbuf)
 {
 	struct stat tmp;
 	int i;
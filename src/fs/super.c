@@ -27,6 +27,8 @@ __res; })
 struct super_block super_block[NR_SUPER];
 /* this is initialized in init/main.c */
 int ROOT_DEV = 0;
+/* ... and this by rd_load() for a compressed ram disk */
+int root_mountflags = 0;
 
 static void lock_super(struct super_block * sb)
 {
@@ -74,7 +76,6 @@ struct super_block * get_super(int dev)
 void put_super(int dev)
 {
 	struct super_block * sb;
-	int i;
 
 	if (dev == ROOT_DEV) {
 		printk("root diskette changed: prepare for armageddon\n\r");
@@ -87,26 +88,30 @@ void put_super(int dev)
 		return;
 	}
 	lock_super(sb);
+	sb->s_op->put_super(sb);
+	invalidate_cache(dev,0);
 	sb->s_dev = 0;
-	for(i=0;i<I_MAP_SLOTS;i++)
-		brelse(sb->s_imap[i]);
-	for(i=0;i<Z_MAP_SLOTS;i++)
-		brelse(sb->s_zmap[i]);
 	free_super(sb);
 	return;
 }
 
-static struct super_block * read_super(int dev)
+static int count_free(struct buffer_head ** map, int bits)
+{
+	int i, free = 0;
+
+	for (i = 0 ; i < bits ; i++)
+		if (map[i>>13] && !set_bit(i&8191,map[i>>13]->b_data))
+			free++;
+	return free;
+}
+
+/*
+ * Grabs a free slot in super_block[] for 'dev' and returns it locked.
+ */
+static struct super_block * get_empty_super(int dev)
 {
 	struct super_block * s;
-	struct buffer_head * bh;
-	int i,block;
 
-	if (!dev)
-		return NULL;
-	check_disk_change(dev);
-	if (s = get_super(dev))
-		return s;
 	for (s = 0+super_block ;; s++) {
 		if (s >= NR_SUPER+super_block)
 			return NULL;
@@ -119,7 +124,28 @@ static struct super_block * read_super(int dev)
 	s->s_time = 0;
 	s->s_rd_only = 0;
 	s->s_dirt = 0;
+	s->s_flags = 0;
+	s->s_journal = NULL;
+	s->s_op = NULL;
+	s->s_itable = 0;
 	lock_super(s);
+	return s;
+}
+
+static struct super_block * read_super(int dev)
+{
+	struct super_block * s;
+	struct buffer_head * bh;
+	int i,block;
+
+	if (!dev)
+		return NULL;
+	check_disk_change(dev);
+	if (s = get_super(dev))
+		return s;
+	if (!(s = get_empty_super(dev)))
+		return NULL;
+	s->s_op = &minix_super_operations;
 	if (!(bh = bread(dev,1))) {
 		s->s_dev=0;
 		free_super(s);
@@ -161,6 +187,38 @@ static struct super_block * read_super(int dev)
 	}
 	s->s_imap[0]->b_data[0] |= 1;
 	s->s_zmap[0]->b_data[0] |= 1;
+/*
+ * The counts have to be right before anybody can get_super() this, and
+ * again after the replay, which may have changed the bitmaps. Counting
+ * doesn't sleep.
+ */
+	s->s_free_zones = count_free(s->s_zmap,s->s_nzones-s->s_firstdatazone+1);
+	s->s_free_inodes = count_free(s->s_imap,s->s_ninodes+1);
+	free_super(s);
+	journal_replay(s);
+	s->s_free_zones = count_free(s->s_zmap,s->s_nzones-s->s_firstdatazone+1);
+	s->s_free_inodes = count_free(s->s_imap,s->s_ninodes+1);
+	return s;
+}
+
+/*
+ * tmpfs has no device: it gets an unnamed one, minor being the slot.
+ */
+static struct super_block * read_tmpfs(void)
+{
+	struct super_block * s;
+	int i;
+
+	for (i = 0 ; i < NR_SUPER ; i++)
+		if (!super_block[i].s_dev)
+			break;
+	if (i >= NR_SUPER || !(s = get_empty_super(i+1)))
+		return NULL;
+	if (!tmpfs_read_super(s)) {
+		s->s_dev = 0;
+		free_super(s);
+		return NULL;
+	}
 	free_super(s);
 	return s;
 }
@@ -174,7 +232,10 @@ int sys_umount(char * dev_name)
 	if (!(inode=namei(dev_name)))
 		return -ENOENT;
 	dev = inode->i_zone[0];
-	if (!S_ISBLK(inode->i_mode)) {
+/* a mount point names the filesystem mounted on it: that's all tmpfs has */
+	if (S_ISDIR(inode->i_mode) && inode->i_num == ROOT_INO)
+		dev = inode->i_dev;
+	else if (!S_ISBLK(inode->i_mode)) {
 		iput(inode);
 		return -ENOTBLK;
 	}
@@ -187,7 +248,13 @@ int sys_umount(char * dev_name)
 		printk("Mounted inode has i_mount=0\n");
 	for (inode=inode_table+0 ; inode<inode_table+NR_INODE ; inode++)
 		if (inode->i_dev==dev && inode->i_count)
+			if (inode != sb->s_journal || inode->i_count > 1)
 				return -EBUSY;
+	if (sb->s_journal) {
+		journal_commit(sb);
+		iput(sb->s_journal);
+		sb->s_journal = NULL;
+	}
 	sb->s_imount->i_mount=0;
 	iput(sb->s_imount);
 	sb->s_imount = NULL;
@@ -198,20 +265,22 @@ int sys_umount(char * dev_name)
 	return 0;
 }
 
-int sys_mount(char * dev_name, char * dir_name, int rw_flag)
+int sys_mount(char * dev_name, char * dir_name, int flags)
 {
 	struct m_inode * dev_i, * dir_i;
 	struct super_block * sb;
-	int dev;
+	int dev = 0;
 
-	if (!(dev_i=namei(dev_name)))
-		return -ENOENT;
-	dev = dev_i->i_zone[0];
-	if (!S_ISBLK(dev_i->i_mode)) {
+	if (!(flags & MS_TMPFS)) {
+		if (!(dev_i=namei(dev_name)))
+			return -ENOENT;
+		dev = dev_i->i_zone[0];
+		if (!S_ISBLK(dev_i->i_mode)) {
+			iput(dev_i);
+			return -EPERM;
+		}
 		iput(dev_i);
-		return -EPERM;
 	}
-	iput(dev_i);
 	if (!(dir_i=namei(dir_name)))
 		return -ENOENT;
 	if (dir_i->i_count != 1 || dir_i->i_num == ROOT_INO) {
@@ -222,7 +291,11 @@ int sys_mount(char * dev_name, char * dir_name, int rw_flag)
 		iput(dir_i);
 		return -EPERM;
 	}
-	if (!(sb=read_super(dev))) {
+	if (flags & MS_TMPFS)
+		sb = read_tmpfs();
+	else
+		sb = read_super(dev);
+	if (!sb) {
 		iput(dir_i);
 		return -EBUSY;
 	}
@@ -234,6 +307,8 @@ int sys_mount(char * dev_name, char * dir_name, int rw_flag)
 		iput(dir_i);
 		return -EPERM;
 	}
+	sb->s_flags = flags & MS_MASK;
+	sb->s_rd_only = (flags & MS_RDONLY) != 0;
 	sb->s_imount=dir_i;
 	dir_i->i_mount=1;
 	dir_i->i_dirt=1;		/* NOTE! we don't iput(dir_i) */
@@ -242,7 +317,7 @@ int sys_mount(char * dev_name, char * dir_name, int rw_flag)
 
 void mount_root(void)
 {
-	int i,free;
+	int i;
 	struct super_block * p;
 	struct m_inode * mi;
 
@@ -261,22 +336,14 @@ void mount_root(void)
 	}
 	if (!(p=read_super(ROOT_DEV)))
 		panic("Unable to mount root");
+	p->s_flags = root_mountflags & MS_MASK;
+	p->s_rd_only = (root_mountflags & MS_RDONLY) != 0;
 	if (!(mi=iget(ROOT_DEV,ROOT_INO)))
 		panic("Unable to read root i-node");
 	mi->i_count += 3 ;	/* NOTE! it is logically used 4 times, not 1 */
 	p->s_isup = p->s_imount = mi;
 	current->pwd = mi;
 	current->root = mi;
-	free=0;
-	i=p->s_nzones;
-	while (-- i >= 0)
-		if (!set_bit(i&8191,p->s_zmap[i>>13]->b_data))
-			free++;
-	printk("%d/%d free blocks\n\r",free,p->s_nzones);
-	free=0;
-	i=p->s_ninodes+1;
-	while (-- i >= 0)
-		if (!set_bit(i&8191,p->s_imap[i>>13]->b_data))
-			free++;
-	printk("%d/%d free inodes\n\r",free,p->s_ninodes);
+	printk("%d/%d free blocks\n\r",p->s_free_zones,p->s_nzones);
+	printk("%d/%d free inodes\n\r",p->s_free_inodes,p->s_ninodes);
 }
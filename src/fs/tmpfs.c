@@ -0,0 +1,632 @@
+/*
+ *  linux/fs/tmpfs.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * tmpfs keeps everything in pages from get_free_page(): no buffer
+ * cache and no device behind it. The d_inodes of a mount live in one
+ * page (s_itable), so iget()/iput() work as for minix. i_zone[] holds
+ * page numbers instead of zones: 7 direct ones and a page of indirect
+ * ones in i_zone[7]. Directories are minix directories in such pages.
+ *
+ * mount("", dir, MS_TMPFS) makes one, umount(dir) throws it away.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <const.h>
+#include <sys/stat.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/locks.h>
+#include <asm/system.h>
+#include <asm/segment.h>
+
+#define TMPFS_MAGIC	0x746d
+#define TMPFS_INODES	(PAGE_SIZE/sizeof (struct d_inode))	/* 0 unused */
+#define TMPFS_PAGES	512		/* 2MB a mount */
+#define NR_DIRECT	7
+#define NR_INDIRECT	(PAGE_SIZE/sizeof (unsigned short))
+#define PAGE_ENTRIES	(PAGE_SIZE/sizeof (struct dir_entry))
+
+#define itable(sb) ((struct d_inode *) (sb)->s_itable)
+#define page_addr(nr) (((unsigned long) (nr)) << 12)
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+static struct inode_operations tmpfs_inode_operations;
+
+/*
+ * The pages count against the mount's s_nzones, so a runaway /tmp
+ * can't eat all of memory.
+ */
+static unsigned long new_page(struct super_block * sb)
+{
+	unsigned long page;
+
+	if (!sb->s_free_zones || !(page = get_free_page()))
+		return 0;
+	sb->s_free_zones--;
+	return page;
+}
+
+static void drop_page(struct super_block * sb, unsigned short nr)
+{
+	free_page(page_addr(nr));
+	sb->s_free_zones++;
+}
+
+/*
+ * Returns the address of page 'nr' of the file, 0 for a hole (or if
+ * we're out of pages when 'create' is set).
+ */
+static unsigned long tmpfs_page(struct m_inode * inode, int nr, int create)
+{
+	unsigned short * p;
+	unsigned long page;
+
+	if (nr < 0 || nr >= NR_DIRECT+NR_INDIRECT)
+		return 0;
+	if (nr < NR_DIRECT)
+		p = inode->i_zone + nr;
+	else {
+		if (!inode->i_zone[7]) {
+			if (!create || !(page = new_page(inode->i_sb)))
+				return 0;
+			inode->i_zone[7] = page >> 12;
+			inode->i_dirt = 1;
+		}
+		p = (nr-NR_DIRECT) + (unsigned short *) page_addr(inode->i_zone[7]);
+	}
+	if (create && !*p) {
+		if (!(page = new_page(inode->i_sb)))
+			return 0;
+		*p = page >> 12;
+		inode->i_ctime = CURRENT_TIME;
+		inode->i_dirt = 1;
+	}
+	return page_addr(*p);
+}
+
+static void free_zones(struct super_block * sb, unsigned short * zone)
+{
+	unsigned short * p;
+	int i;
+
+	for (i = 0 ; i < NR_DIRECT ; i++)
+		if (zone[i]) {
+			drop_page(sb,zone[i]);
+			zone[i] = 0;
+		}
+	if (!zone[7])
+		return;
+	p = (unsigned short *) page_addr(zone[7]);
+	for (i = 0 ; i < NR_INDIRECT ; i++)
+		if (p[i])
+			drop_page(sb,p[i]);
+	drop_page(sb,zone[7]);
+	zone[7] = 0;
+}
+
+static void tmpfs_truncate(struct m_inode * inode)
+{
+	if (!(S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode)))
+		return;
+	lock_inode(inode);
+	free_zones(inode->i_sb,inode->i_zone);
+	inode->i_size = 0;
+	inode->i_mtime = inode->i_ctime = CURRENT_TIME;
+	inode->i_dirt = 1;
+	unlock_inode(inode);
+}
+
+static int tmpfs_read(struct m_inode * inode, struct file * filp,
+	char * buf, int count)
+{
+	int left,chars,nr;
+	unsigned long page;
+	char * p;
+
+	if ((left=count)<=0)
+		return 0;
+	lock_inode(inode);
+	while (left) {
+		page = tmpfs_page(inode,filp->f_pos/PAGE_SIZE,0);
+		nr = filp->f_pos % PAGE_SIZE;
+		chars = MIN( PAGE_SIZE-nr , left );
+		filp->f_pos += chars;
+		left -= chars;
+		if (page) {
+			p = nr + (char *) page;
+			while (chars-->0)
+				put_fs_byte(*(p++),buf++);
+		} else {
+			while (chars-->0)
+				put_fs_byte(0,buf++);
+		}
+	}
+	unlock_inode(inode);
+	update_atime(inode);
+	return count;
+}
+
+static int tmpfs_write(struct m_inode * inode, struct file * filp,
+	char * buf, int count)
+{
+	off_t pos;
+	unsigned long page;
+	int c, i = 0;
+	char * p;
+
+	lock_inode(inode);
+	if (filp->f_flags & O_APPEND)
+		pos = inode->i_size;
+	else
+		pos = filp->f_pos;
+	while (i<count) {
+		if (!(page = tmpfs_page(inode,pos/PAGE_SIZE,1)))
+			break;
+		c = pos % PAGE_SIZE;
+		p = c + (char *) page;
+		c = PAGE_SIZE-c;
+		if (c > count-i) c = count-i;
+		pos += c;
+		if (pos > inode->i_size) {
+			inode->i_size = pos;
+			inode->i_dirt = 1;
+		}
+		i += c;
+		while (c-->0)
+			*(p++) = get_fs_byte(buf++);
+	}
+	inode->i_mtime = CURRENT_TIME;
+	if (!(filp->f_flags & O_APPEND)) {
+		filp->f_pos = pos;
+		inode->i_ctime = CURRENT_TIME;
+	}
+	inode->i_dirt = 1;
+	unlock_inode(inode);
+	return (i?i:-ENOSPC);
+}
+
+static int tmpfs_readdir(struct m_inode * inode, struct file * filp,
+	char * buf, int count, int flags)
+{
+	struct dir_entry * de;
+	unsigned long page;
+	int size, done = 0;
+
+	filp->f_pos &= ~(sizeof (struct dir_entry) - 1);
+	for ( ; filp->f_pos < inode->i_size ;
+	    filp->f_pos += sizeof (struct dir_entry)) {
+		if (!(page = tmpfs_page(inode,filp->f_pos/PAGE_SIZE,0)))
+			continue;
+		de = (struct dir_entry *) (page + filp->f_pos % PAGE_SIZE);
+		if (!de->inode)
+			continue;
+		size = put_dirent(inode,de,filp->f_pos + sizeof (struct dir_entry),
+			buf,count,flags);
+		if (size <= 0) {
+			if (done)
+				break;
+			return size ? size : -EINVAL;
+		}
+		buf += size;
+		count -= size;
+		done += size;
+	}
+	update_atime(inode);
+	return done;
+}
+
+/*
+ * Same as in minix/namei.c, without the assembly.
+ */
+static int match(int len,const char * name,struct dir_entry * de)
+{
+	int i;
+
+	if (!de->inode || len > NAME_LEN)
+		return 0;
+	if (!len)
+		return de->name[0]=='.' && !de->name[1];
+	if (len < NAME_LEN && de->name[len])
+		return 0;
+	for (i = 0 ; i < len ; i++)
+		if (get_fs_byte(name+i) != de->name[i])
+			return 0;
+	return 1;
+}
+
+static struct dir_entry * find_entry(struct m_inode * dir,
+	const char * name, int namelen)
+{
+	struct dir_entry * de;
+	unsigned long page = 0;
+	int i, entries;
+
+	if (namelen > NAME_LEN)
+		namelen = NAME_LEN;
+	entries = dir->i_size / sizeof (struct dir_entry);
+	for (i = 0 ; i < entries ; i++) {
+		if (!(i % PAGE_ENTRIES) &&
+		    !(page = tmpfs_page(dir,i/PAGE_ENTRIES,0))) {
+			i += PAGE_ENTRIES-1;
+			continue;
+		}
+		de = i % PAGE_ENTRIES + (struct dir_entry *) page;
+		if (match(namelen,name,de))
+			return de;
+	}
+	return NULL;
+}
+
+/*
+ * As with minix, the inode part of the new entry is left at 0, so
+ * don't sleep before filling it in.
+ */
+static struct dir_entry * add_entry(struct m_inode * dir,
+	const char * name, int namelen)
+{
+	struct dir_entry * de;
+	unsigned long page;
+	int i, j;
+
+	if (namelen > NAME_LEN)
+		namelen = NAME_LEN;
+	if (!namelen)
+		return NULL;
+	for (i = 0 ; ; i++) {
+		if (!(page = tmpfs_page(dir,i/PAGE_ENTRIES,1)))
+			return NULL;
+		de = i % PAGE_ENTRIES + (struct dir_entry *) page;
+		if (i*sizeof (struct dir_entry) >= dir->i_size) {
+			de->inode = 0;
+			dir->i_size = (i+1)*sizeof (struct dir_entry);
+		}
+		if (!de->inode)
+			break;
+	}
+	for (j = 0 ; j < NAME_LEN ; j++)
+		de->name[j] = (j<namelen)?get_fs_byte(name+j):0;
+	dir->i_mtime = dir->i_ctime = CURRENT_TIME;
+	dir->i_dirt = 1;
+	return de;
+}
+
+static int empty_dir(struct m_inode * inode)
+{
+	struct dir_entry * de;
+	unsigned long page = 0;
+	int i, entries;
+
+	entries = inode->i_size / sizeof (struct dir_entry);
+	for (i = 2 ; i < entries ; i++) {
+		if ((i == 2 || !(i % PAGE_ENTRIES)) &&
+		    !(page = tmpfs_page(inode,i/PAGE_ENTRIES,0))) {
+			i += PAGE_ENTRIES-1 - i % PAGE_ENTRIES;
+			continue;
+		}
+		de = i % PAGE_ENTRIES + (struct dir_entry *) page;
+		if (de->inode)
+			return 0;
+	}
+	return 1;
+}
+
+static struct m_inode * tmpfs_new_inode(struct m_inode * dir, int mode)
+{
+	struct super_block * sb = dir->i_sb;
+	struct m_inode * inode;
+	int i;
+
+	if (!(inode = get_empty_inode()))
+		return NULL;
+	for (i = ROOT_INO+1 ; i < TMPFS_INODES ; i++)
+		if (!itable(sb)[i].i_mode)
+			break;
+	if (i >= TMPFS_INODES) {
+		iput(inode);
+		return NULL;
+	}
+	itable(sb)[i].i_mode = mode;	/* taken */
+	sb->s_free_inodes--;
+	inode->i_count = 1;
+	inode->i_nlinks = 1;
+	inode->i_mode = mode;
+	inode->i_dev = sb->s_dev;
+	inode->i_sb = sb;
+	inode->i_op = &tmpfs_inode_operations;
+	inode->i_uid = current->euid;
+	inode->i_gid = current->egid;
+	inode->i_num = i;
+	inode->i_mtime = inode->i_atime = inode->i_ctime = CURRENT_TIME;
+	inode->i_dirt = 1;
+	return inode;
+}
+
+static int tmpfs_lookup(struct m_inode * dir, const char * name, int len,
+	struct m_inode ** result)
+{
+	struct dir_entry * de;
+
+	*result = NULL;
+	if (!(de = find_entry(dir,name,len)))
+		return -ENOENT;
+	if (!(*result = iget(dir->i_dev,de->inode)))
+		return -EACCES;
+	return 0;
+}
+
+static int tmpfs_create(struct m_inode * dir, const char * name, int len,
+	int mode, struct m_inode ** result)
+{
+	struct m_inode * inode;
+	struct dir_entry * de;
+
+	*result = NULL;
+	if (!(inode = tmpfs_new_inode(dir,mode)))
+		return -ENOSPC;
+	if (!(de = add_entry(dir,name,len))) {
+		inode->i_nlinks--;
+		iput(inode);
+		return -ENOSPC;
+	}
+	de->inode = inode->i_num;
+	*result = inode;
+	return 0;
+}
+
+static int tmpfs_mknod(struct m_inode * dir, const char * name, int len,
+	int mode, int rdev)
+{
+	struct m_inode * inode;
+	struct dir_entry * de;
+
+	if (find_entry(dir,name,len))
+		return -EEXIST;
+	if (!(inode = tmpfs_new_inode(dir,mode)))
+		return -ENOSPC;
+	if (S_ISBLK(mode) || S_ISCHR(mode))
+		inode->i_zone[0] = rdev;
+	if (!(de = add_entry(dir,name,len))) {
+		inode->i_nlinks--;
+		iput(inode);
+		return -ENOSPC;
+	}
+	de->inode = inode->i_num;
+	iput(inode);
+	return 0;
+}
+
+static int tmpfs_mkdir(struct m_inode * dir, const char * name, int len,
+	int mode)
+{
+	struct m_inode * inode;
+	struct dir_entry * de;
+
+	if (find_entry(dir,name,len))
+		return -EEXIST;
+	mode = I_DIRECTORY | (mode & 0777 & ~current->umask);
+	if (!(inode = tmpfs_new_inode(dir,mode)))
+		return -ENOSPC;
+	if (!(de = (struct dir_entry *) tmpfs_page(inode,0,1))) {
+		inode->i_nlinks--;
+		iput(inode);
+		return -ENOSPC;
+	}
+	de[0].inode = inode->i_num;
+	strcpy(de[0].name,".");
+	de[1].inode = dir->i_num;
+	strcpy(de[1].name,"..");
+	inode->i_size = 2 * sizeof (struct dir_entry);
+	inode->i_nlinks = 2;
+	if (!(de = add_entry(dir,name,len))) {
+		inode->i_nlinks = 0;
+		iput(inode);
+		return -ENOSPC;
+	}
+	de->inode = inode->i_num;
+	dir->i_nlinks++;
+	iput(inode);
+	return 0;
+}
+
+static int tmpfs_rmdir(struct m_inode * dir, const char * name, int len)
+{
+	struct m_inode * inode;
+	struct dir_entry * de;
+
+	if (!(de = find_entry(dir,name,len)))
+		return -ENOENT;
+	if (!(inode = iget(dir->i_dev,de->inode)))
+		return -EPERM;
+	if ((dir->i_mode & S_ISVTX) && current->euid &&
+	    inode->i_uid != current->euid) {
+		iput(inode);
+		return -EPERM;
+	}
+	if (inode->i_dev != dir->i_dev || inode->i_count>1 || inode == dir) {
+		iput(inode);
+		return -EPERM;
+	}
+	if (!S_ISDIR(inode->i_mode)) {
+		iput(inode);
+		return -ENOTDIR;
+	}
+	if (!empty_dir(inode)) {
+		iput(inode);
+		return -ENOTEMPTY;
+	}
+	de->inode = 0;
+	inode->i_nlinks = 0;
+	inode->i_dirt = 1;
+	dir->i_nlinks--;
+	dir->i_ctime = dir->i_mtime = CURRENT_TIME;
+	dir->i_dirt = 1;
+	iput(inode);
+	return 0;
+}
+
+static int tmpfs_unlink(struct m_inode * dir, const char * name, int len)
+{
+	struct m_inode * inode;
+	struct dir_entry * de;
+
+	if (!(de = find_entry(dir,name,len)))
+		return -ENOENT;
+	if (!(inode = iget(dir->i_dev,de->inode)))
+		return -ENOENT;
+	if ((dir->i_mode & S_ISVTX) && !suser() &&
+	    current->euid != inode->i_uid &&
+	    current->euid != dir->i_uid) {
+		iput(inode);
+		return -EPERM;
+	}
+	if (S_ISDIR(inode->i_mode)) {
+		iput(inode);
+		return -EPERM;
+	}
+	de->inode = 0;
+	dir->i_ctime = dir->i_mtime = CURRENT_TIME;
+	dir->i_dirt = 1;
+	inode->i_nlinks--;
+	inode->i_ctime = CURRENT_TIME;
+	inode->i_dirt = 1;
+	iput(inode);
+	return 0;
+}
+
+static int tmpfs_link(struct m_inode * oldinode, struct m_inode * dir,
+	const char * name, int len)
+{
+	struct dir_entry * de;
+
+	if (find_entry(dir,name,len))
+		return -EEXIST;
+	if (!(de = add_entry(dir,name,len)))
+		return -ENOSPC;
+	de->inode = oldinode->i_num;
+	oldinode->i_nlinks++;
+	oldinode->i_ctime = CURRENT_TIME;
+	oldinode->i_dirt = 1;
+	return 0;
+}
+
+static void tmpfs_read_inode(struct m_inode * inode)
+{
+	memcpy(inode,itable(inode->i_sb)+inode->i_num,sizeof (struct d_inode));
+	inode->i_op = &tmpfs_inode_operations;
+}
+
+static void tmpfs_write_inode(struct m_inode * inode)
+{
+	itable(inode->i_sb)[inode->i_num] = *(struct d_inode *) inode;
+	inode->i_dirt = 0;
+}
+
+static void tmpfs_put_inode(struct m_inode * inode)
+{
+	struct super_block * sb = inode->i_sb;
+
+	tmpfs_truncate(inode);
+	memset(itable(sb)+inode->i_num,0,sizeof (struct d_inode));
+	sb->s_free_inodes++;
+	memset(inode,0,sizeof(*inode));
+}
+
+/*
+ * umount made sure nobody uses us, but unused inodes may still sit in
+ * inode_table[]: they must go before the slot (and so our dev) is reused.
+ */
+static void tmpfs_put_super(struct super_block * sb)
+{
+	int i;
+
+	invalidate_inodes(sb->s_dev);
+	for (i = ROOT_INO ; i < TMPFS_INODES ; i++) {
+		if (!itable(sb)[i].i_mode)
+			continue;
+		if (S_ISREG(itable(sb)[i].i_mode) || S_ISDIR(itable(sb)[i].i_mode))
+			free_zones(sb,itable(sb)[i].i_zone);
+	}
+	free_page(sb->s_itable);
+	sb->s_itable = 0;
+}
+
+static struct file_operations tmpfs_file_operations = {
+	tmpfs_read,
+	tmpfs_write,
+	tmpfs_readdir,
+	NULL			/* fsync: nothing to write back */
+};
+
+static struct inode_operations tmpfs_inode_operations = {
+	&tmpfs_file_operations,
+	tmpfs_lookup,
+	tmpfs_create,
+	tmpfs_mknod,
+	tmpfs_mkdir,
+	tmpfs_rmdir,
+	tmpfs_unlink,
+	NULL,			/* symlink */
+	tmpfs_link,
+	NULL,			/* follow_link */
+	NULL,			/* bmap: can't be paged in by exec */
+	tmpfs_truncate
+};
+
+static struct super_operations tmpfs_super_operations = {
+	tmpfs_read_inode,
+	tmpfs_write_inode,
+	tmpfs_put_inode,
+	tmpfs_put_super
+};
+
+/*
+ * Sets up an empty tmpfs in 's', which super.c has locked and given an
+ * unnamed device. The root directory is world-writable and sticky.
+ */
+struct super_block * tmpfs_read_super(struct super_block * s)
+{
+	struct d_inode * root;
+	struct dir_entry * de;
+	int i;
+
+	if (!(s->s_itable = get_free_page()))
+		return NULL;
+	if (!(de = (struct dir_entry *) get_free_page())) {
+		free_page(s->s_itable);
+		s->s_itable = 0;
+		return NULL;
+	}
+	s->s_ninodes = TMPFS_INODES-1;
+	s->s_nzones = TMPFS_PAGES;
+	s->s_imap_blocks = s->s_zmap_blocks = 0;
+	s->s_firstdatazone = 0;
+	s->s_log_zone_size = 2;		/* 4kB pages */
+	s->s_max_size = (NR_DIRECT+NR_INDIRECT)*PAGE_SIZE;
+	s->s_magic = TMPFS_MAGIC;
+	for (i=0;i<I_MAP_SLOTS;i++)
+		s->s_imap[i] = NULL;
+	for (i=0;i<Z_MAP_SLOTS;i++)
+		s->s_zmap[i] = NULL;
+	s->s_op = &tmpfs_super_operations;
+	s->s_free_inodes = s->s_ninodes-1;
+	s->s_free_zones = s->s_nzones-1;
+	de[0].inode = de[1].inode = ROOT_INO;
+	strcpy(de[0].name,".");
+	strcpy(de[1].name,"..");
+	root = itable(s)+ROOT_INO;
+	root->i_mode = I_DIRECTORY | 01777;
+	root->i_size = 2 * sizeof (struct dir_entry);
+	root->i_time = CURRENT_TIME;
+	root->i_nlinks = 2;
+	root->i_zone[0] = ((unsigned long) de) >> 12;
+	return s;
+}
@@ -7,11 +7,12 @@
 #define _FS_H
 
 #include <sys/types.h>
+#include <sys/mount.h>
 
 /* devices are as follows: (same as minix, so we can use the minix
  * file system. These are major numbers.)
  *
- * 0 - unused (nodev)
+ * 0 - unnamed (tmpfs mounts, minor is the super_block slot)
  * 1 - /dev/mem
  * 2 - /dev/fd
  * 3 - /dev/hd
@@ -21,7 +22,7 @@
  * 7 - unnamed pipes
  */
 
-#define IS_SEEKABLE(x) ((x)>=1 && (x)<=3)
+#define IS_SEEKABLE(x) ((x)<=3)
 
 #define READ 0
 #define WRITE 1
@@ -36,6 +37,11 @@ void buffer_init(long buffer_end);
 #define NAME_LEN 14
 #define ROOT_INO 1
 
+/* the MS_xxx flags that stay with the super block */
+#define MS_MASK		31
+
+#define IS_RDONLY(inode) ((inode)->i_sb && (inode)->i_sb->s_rd_only)
+
 #define I_MAP_SLOTS 8
 #define Z_MAP_SLOTS 8
 #define SUPER_MAGIC 0x137F
@@ -78,6 +84,7 @@ struct buffer_head {
 	unsigned char b_dirt;		/* 0-clean,1-dirty */
 	unsigned char b_count;		/* users using this block */
 	unsigned char b_lock;		/* 0 - ok, 1 -locked */
+	unsigned char b_meta;		/* directory or indirect block */
 	struct task_struct * b_wait;
 	struct buffer_head * b_prev;
 	struct buffer_head * b_next;
@@ -109,6 +116,7 @@ struct m_inode {
 	struct task_struct * i_wait2;	/* for pipes */
 	unsigned long i_atime;
 	unsigned long i_ctime;
+	unsigned long i_dir_free;	/* no free dir entry below this one */
 	unsigned short i_dev;
 	unsigned short i_num;
 	unsigned short i_count;
@@ -118,6 +126,12 @@ struct m_inode {
 	unsigned char i_mount;
 	unsigned char i_seek;
 	unsigned char i_update;
+	unsigned char i_free_later;	/* truncd holds the last reference */
+	unsigned char i_notify;		/* pipe inode of an inotify fd */
+	unsigned char i_watched;	/* nr of inotify watches on it */
+	unsigned char i_defrag;		/* defrag() is moving its blocks */
+	struct inode_operations * i_op;
+	struct super_block * i_sb;
 };
 
 struct file {
@@ -148,6 +162,13 @@ struct super_block {
 	unsigned char s_lock;
 	unsigned char s_rd_only;
 	unsigned char s_dirt;
+	unsigned short s_free_zones;	/* kept up to date by bitmap.c */
+	unsigned short s_free_inodes;
+	unsigned short s_flags;		/* MS_xxx */
+	struct m_inode * s_journal;	/* NULL if not journalled */
+	unsigned short s_jblocks;	/* room in the journal */
+	struct super_operations * s_op;
+	unsigned long s_itable;		/* tmpfs: page holding its d_inodes */
 };
 
 struct d_super_block {
@@ -166,6 +187,41 @@ struct dir_entry {
 	char name[NAME_LEN];
 };
 
+/*
+ * Everything that depends on how a filesystem keeps its data goes
+ * through these. Regular files and directories use the inode's
+ * default_file_ops, devices and pipes are still done by mode. None
+ * of the inode operations iput() the inodes they are handed.
+ */
+struct file_operations {
+	int (*read) (struct m_inode *, struct file *, char *, int);
+	int (*write) (struct m_inode *, struct file *, char *, int);
+	int (*readdir) (struct m_inode *, struct file *, char *, int, int);
+	int (*fsync) (struct m_inode *, struct file *);
+};
+
+struct inode_operations {
+	struct file_operations * default_file_ops;
+	int (*lookup) (struct m_inode *,const char *,int,struct m_inode **);
+	int (*create) (struct m_inode *,const char *,int,int,struct m_inode **);
+	int (*mknod) (struct m_inode *,const char *,int,int,int);
+	int (*mkdir) (struct m_inode *,const char *,int,int);
+	int (*rmdir) (struct m_inode *,const char *,int);
+	int (*unlink) (struct m_inode *,const char *,int);
+	int (*symlink) (struct m_inode *,const char *,int,const char *);
+	int (*link) (struct m_inode *,struct m_inode *,const char *,int);
+	struct m_inode * (*follow_link) (struct m_inode *,struct m_inode *);
+	int (*bmap) (struct m_inode *,int);
+	void (*truncate) (struct m_inode *);
+};
+
+struct super_operations {
+	void (*read_inode) (struct m_inode *);
+	void (*write_inode) (struct m_inode *);
+	void (*put_inode) (struct m_inode *);	/* last iput, no links left */
+	void (*put_super) (struct super_block *);
+};
+
 extern struct m_inode inode_table[NR_INODE];
 extern struct file file_table[NR_FILE];
 extern struct super_block super_block[NR_SUPER];
@@ -179,6 +235,9 @@ extern void floppy_on(unsigned int dev);
 extern void floppy_off(unsigned int dev);
 extern void truncate(struct m_inode * inode);
 extern void sync_inodes(void);
+extern void sync_inode(struct m_inode * inode);
+extern void update_atime(struct m_inode * inode);
+extern void file_fsync(struct m_inode * inode, int first, int last);
 extern void wait_on(struct m_inode * inode);
 extern int bmap(struct m_inode * inode,int block);
 extern int create_block(struct m_inode * inode,int block);
@@ -194,17 +253,63 @@ extern struct buffer_head * get_hash_table(int dev, int block);
 extern struct buffer_head * getblk(int dev, int block);
 extern void ll_rw_block(int rw, struct buffer_head * bh);
 extern void ll_rw_page(int rw, int dev, int nr, char * buffer);
+extern void ll_rw_direct(int rw, struct buffer_head * bh, int nr_sectors);
+extern int direct_io(int rw, int dev, struct m_inode * inode,
+	int (*map)(struct m_inode *, int), int block, char * buf, int nr);
 extern void brelse(struct buffer_head * buf);
 extern struct buffer_head * bread(int dev,int block);
 extern void bread_page(unsigned long addr,int dev,int b[4]);
 extern struct buffer_head * breada(int dev,int block,...);
 extern int new_block(int dev);
+extern int new_blocks(int dev, int nr);
 extern int free_block(int dev, int block);
+extern int free_blocks(int dev, unsigned short * p, int nr);
+extern int free_later(struct m_inode * inode);
 extern struct m_inode * new_inode(int dev);
 extern void free_inode(struct m_inode * inode);
 extern int sync_dev(int dev);
+extern void journal_start(void);
+extern void journal_stop(void);
+extern int journal_commit(struct super_block * sb);
+extern int journal_sync(void);
+extern void journal_restart(void);
+extern int journal_pinned(struct buffer_head * bh);
+extern void journal_replay(struct super_block * sb);
 extern struct super_block * get_super(int dev);
+extern struct m_inode * _namei(const char * pathname, struct m_inode * base,
+	int follow_links);
+extern void invalidate_inodes(int dev);
+extern void fsnotify(struct m_inode * inode, int mask, const char * name,
+	int len);
+extern void notify_release(struct m_inode * notify);
+extern int read_notify(struct m_inode * inode, struct file * filp,
+	char * buf, int count);
+extern int put_dirent(struct m_inode * dir, struct dir_entry * de, off_t off,
+	char * buf, int count, int flags);
+
+extern struct inode_operations minix_inode_operations;
+extern struct super_operations minix_super_operations;
+extern int minix_lookup(struct m_inode * dir, const char * name, int len,
+	struct m_inode ** result);
+extern int minix_create(struct m_inode * dir, const char * name, int len,
+	int mode, struct m_inode ** result);
+extern int minix_mknod(struct m_inode * dir, const char * name, int len,
+	int mode, int rdev);
+extern int minix_mkdir(struct m_inode * dir, const char * name, int len,
+	int mode);
+extern int minix_rmdir(struct m_inode * dir, const char * name, int len);
+extern int minix_unlink(struct m_inode * dir, const char * name, int len);
+extern int minix_symlink(struct m_inode * dir, const char * name, int len,
+	const char * symname);
+extern int minix_link(struct m_inode * oldinode, struct m_inode * dir,
+	const char * name, int len);
+extern struct m_inode * minix_follow_link(struct m_inode * dir,
+	struct m_inode * inode);
+extern int minix_fsync(struct m_inode * inode, struct file * filp);
+
+extern struct super_block * tmpfs_read_super(struct super_block * s);
 extern int ROOT_DEV;
+extern int root_mountflags;
 
 extern void mount_root(void);
 
@@ -16,6 +16,9 @@ extern void sysbeepstop(void);
 extern void blank_screen(void);
 extern void unblank_screen(void);
 
+extern int truncate_daemon(void);
+extern int swap_daemon(void);
+
 extern int beepcount;
 extern int hd_timeout;
 extern int blankinterval;
@@ -23,6 +26,10 @@ extern int blankcount;
 
 #define free(x) free_s((x), 0)
 
+/* kernel daemons, run in a process of their own by kdaemon() */
+#define KD_TRUNCATE	0	/* frees the blocks of big unlinked files */
+#define KD_SWAP		1	/* keeps some pages free (kswapd) */
+
 /*
  * This is defined as a macro, but at some point this might become a
  * real subroutine that sets a flag if it returns true (to do
@@ -0,0 +1,47 @@
+#ifndef _LOCKS_H
+#define _LOCKS_H
+
+/*
+ * i_lock keeps an inode stable while it is read or written out. It is
+ * never held over buffer I/O of its own blocks: that can end up in
+ * sync_inodes(), which waits for it.
+ */
+#include <linux/sched.h>
+#include <asm/system.h>
+
+extern inline void wait_on_inode(struct m_inode * inode)
+{
+	cli();
+	while (inode->i_lock)
+		sleep_on(&inode->i_wait);
+	sti();
+}
+
+extern inline void lock_inode(struct m_inode * inode)
+{
+	cli();
+	while (inode->i_lock)
+		sleep_on(&inode->i_wait);
+	inode->i_lock=1;
+	sti();
+}
+
+extern inline void unlock_inode(struct m_inode * inode)
+{
+	inode->i_lock=0;
+	wake_up(&inode->i_wait);
+}
+
+/*
+ * Changing the size or the blocks of a file has to wait while defrag()
+ * moves them.
+ */
+extern inline void wait_on_defrag(struct m_inode * inode)
+{
+	cli();
+	while (inode->i_defrag)
+		sleep_on(&inode->i_wait);
+	sti();
+}
+
+#endif
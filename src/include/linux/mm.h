@@ -8,16 +8,40 @@
 #include <signal.h>
 
 extern int SWAP_DEV;
-extern unsigned int swap_device;
-extern struct m_inode * swap_file;
 
-#define read_swap_page(nr,buffer)	ll_rw_page(READ, SWAP_DEV, (nr), (buffer));
-#define write_swap_page(nr,buffer)	ll_rw_page(WRITE, SWAP_DEV, (nr), (buffer));
+/* a swap entry: which swap area, and the page in it */
+#define MAX_SWAPFILES		8
+#define SWP_TYPE(entry)		((entry) >> 24)
+#define SWP_OFFSET(entry)	((entry) & 0xffffff)
+#define SWP_ENTRY(type,offset)	(((type) << 24) | (offset))
+
+extern void rw_swap_page(int rw, unsigned long entry, char * buf);
+#define read_swap_page(nr,buffer)	rw_swap_page(READ, (nr), (buffer));
+#define write_swap_page(nr,buffer)	rw_swap_page(WRITE, (nr), (buffer));
 
 extern unsigned long get_free_page(void);
+extern unsigned long __get_free_page(void);
+extern void fill_zero_pages(void);
+extern unsigned long get_free_pages(int order);
+extern unsigned long free_area_init(unsigned long start_mem);
+extern void free_pages(unsigned long addr, int order);
 extern unsigned long put_dirty_page(unsigned long page,unsigned long address);
 extern void free_page(unsigned long addr);
-void swap_free(int page_nr);
+extern unsigned long pin_page(char * addr, int write);
+extern int unshare_page_table(unsigned long address);
+extern void drop_shared_tables(unsigned long from, unsigned long size);
+extern unsigned long get_cache_page(struct m_inode * inode,
+	unsigned long offset);
+extern void update_vm_cache(struct m_inode * inode, unsigned long pos,
+	char * buf, int count);
+extern void invalidate_cache(int dev, int ino);
+extern unsigned long page_cache_init(unsigned long start_mem);
+extern int shrink_page_cache(void);
+extern int swap_out(void);
+void swap_free(unsigned long entry);
+void swap_duplicate(unsigned long entry);
+extern unsigned long * swap_cache;
+extern unsigned long swap_cache_init(unsigned long start_mem);
 void swap_in(unsigned long *table_ptr);
 
 extern inline volatile void oom(void)
@@ -32,12 +56,15 @@ extern inline volatile void oom(void)
 /* these are not to be changed without changing head.s etc */
 #define LOW_MEM			0x100000
 extern unsigned long HIGH_MEMORY;
-#define PAGING_MEMORY	(15*1024*1024)
+#define PAGING_MEMORY	(HIGH_MEMORY-LOW_MEM)
 #define PAGING_PAGES	(PAGING_MEMORY>>12)
 #define MAP_NR(addr)	(((addr)-LOW_MEM)>>12)
 #define USED			100
 
-extern unsigned char mem_map[PAGING_PAGES];
+extern unsigned char * mem_map;
+
+#define NR_ORDERS		6	/* up to 32 contiguous pages */
+extern int nr_free_pages;
 
 #define PAGE_DIRTY		0x40
 #define PAGE_ACCESSED	0x20
@@ -25,6 +25,10 @@
 
 #define LIBRARY_OFFSET (TASK_SIZE - LIBRARY_SIZE)
 
+/* mmap() puts mappings below MMAP_TOP: that leaves 16MB for the stack */
+#define MMAP_TOP (LIBRARY_OFFSET - 0x01000000)
+#define NR_MMAP	8
+
 #define CT_TO_SECS(x)	((x) / HZ)
 #define CT_TO_USECS(x)	(((x) % HZ) * 1000000/HZ)
 
@@ -102,6 +106,16 @@ struct tss_struct {
 	struct i387_struct i387;
 };
 
+/*
+ * A file mapping: the pages start..end of the data segment are the file
+ * from 'offset' on.
+ */
+struct mmap_struct {
+	unsigned long start,end,offset;
+	unsigned short prot,flags;	/* PROT_xxx, MAP_xxx */
+	struct m_inode * inode;		/* NULL if unused */
+};
+
 struct task_struct {
 /* these are hardcoded - don't touch */
 	long state;	/* -1 unrunnable, 0 runnable, >0 stopped */
@@ -125,6 +139,10 @@ struct task_struct {
 	 * sleep makes a singly linked list with this.
 	 */
 	struct task_struct *next_wait;
+	/*
+	 * a vfork()ed parent sleeps here until the child gives back its memory.
+	 */
+	struct task_struct *vfork_wait;
 	unsigned short uid,euid,suid;
 	unsigned short gid,egid,sgid;
 	unsigned long timeout,alarm;
@@ -138,6 +156,7 @@ struct task_struct {
 	char comm[8];
 /* file system info */
 	int link_count;
+	int journal;		/* nr of journal handles held */
 	int tty;		/* -1 if no tty, so it must be signed */
 	unsigned short umask;
 	struct m_inode * pwd;
@@ -146,6 +165,7 @@ struct task_struct {
 	struct m_inode * library;
 	unsigned long close_on_exec;
 	struct file * filp[NR_OPEN];
+	struct mmap_struct mmap[NR_MMAP];
 /* ldt for this task 0 - zero 1 - cs 2 - ds&ss */
 	struct desc_struct ldt[3];
 /* tss for this task */
@@ -161,6 +181,13 @@ struct task_struct {
 #define PF_VM86		0x00000020	/* set if process can execute a vm86 */
 					/* task. */
                                         /* not impelmented. */
+#define PF_VFORK	0x00000040	/* runs on its parent's memory */
+
+/*
+ * copy_process() flags
+ */
+#define COPY_VFORK	1	/* borrow the parent's memory until exec/exit */
+#define COPY_SPAWN	2	/* start in the kernel, in do_spawn() */
 
 /*
  *  INIT_TASK is used to set up the first task table, touch at
@@ -172,7 +199,7 @@ struct task_struct {
 /* ec,brk... */	0,0,0,0,0,0, \
 /* pid etc.. */	0,0,0,0, \
 /* suppl grps*/ {NOGROUP,}, \
-/* proc links*/ &init_task.task,NULL,NULL,NULL,NULL, \
+/* proc links*/ &init_task.task,NULL,NULL,NULL,NULL,NULL, \
 /* uid etc */	0,0,0,0,0,0, \
 /* timeout */	0,0,0,0,0,0,0, \
 /* min_flt */	0,0,0,0, \
@@ -183,8 +210,9 @@ struct task_struct {
 /* math */	0, \
 /* rss */	2, \
 /* comm */	"swapper", \
-/* fs info */	0,-1,0022,NULL,NULL,NULL,NULL,0, \
+/* fs info */	0,0,-1,0022,NULL,NULL,NULL,NULL,0, \
 /* filp */	{NULL,}, \
+/* mmap */	{{0,},}, \
 	{ \
 		{0,0}, \
 /* ldt */	{0x9f,0xc0fa00}, \
@@ -212,6 +240,10 @@ extern void sleep_on(struct task_struct ** p);
 extern void interruptible_sleep_on(struct task_struct ** p);
 extern void wake_up(struct task_struct ** p);
 extern int in_group_p(gid_t grp);
+extern struct mmap_struct * find_mmap(struct task_struct * tsk,
+	unsigned long addr);
+extern void exit_mmap(void);
+extern void vfork_release(void);
 
 /*
  * Entry into gdt where to find first TSS. 0-nul, 1-cs, 2-ds, 3-syscall
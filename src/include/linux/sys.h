@@ -92,6 +92,21 @@ extern int sys_uselib();
 extern int sys_swapon();
 extern int sys_reboot();
 extern int sys_readdir();
+extern int sys_statfs();
+extern int sys_fsync();
+extern int sys_fdatasync();
+extern int sys_kdaemon();
+extern int sys_defrag();
+extern int sys_inotify_init();
+extern int sys_inotify_add_watch();
+extern int sys_inotify_rm_watch();
+extern int sys_mmap();
+extern int sys_munmap();
+extern int sys_swapoff();
+extern int sys_vfork();
+extern int sys_spawn();
+extern int sys_journal();
+extern int sys_msync();
 
 fn_ptr sys_call_table[] = { sys_setup, sys_exit, sys_fork, sys_read,
 sys_write, sys_open, sys_close, sys_waitpid, sys_creat, sys_link,
@@ -108,7 +123,11 @@ sys_getpgrp, sys_setsid, sys_sigaction, sys_sgetmask, sys_ssetmask,
 sys_setreuid,sys_setregid, sys_sigsuspend, sys_sigpending, sys_sethostname,
 sys_setrlimit, sys_getrlimit, sys_getrusage, sys_gettimeofday, 
 sys_settimeofday, sys_getgroups, sys_setgroups, sys_select, sys_symlink,
-sys_lstat, sys_readlink, sys_uselib };
+sys_lstat, sys_readlink, sys_uselib, sys_swapon, sys_reboot, sys_readdir,
+sys_statfs, sys_fsync, sys_fdatasync, sys_kdaemon, sys_defrag,
+sys_inotify_init, sys_inotify_add_watch, sys_inotify_rm_watch, sys_mmap,
+sys_munmap, sys_swapoff, sys_vfork, sys_spawn, sys_journal,
+sys_msync };
 
 /* So we don't have to do any more manual updating.... */
 int NR_syscalls = sizeof(sys_call_table)/sizeof(fn_ptr);
@@ -0,0 +1,38 @@
+#ifndef _SPAWN_H
+#define _SPAWN_H
+
+#include <sys/types.h>
+#include <signal.h>
+
+/* file actions, done in order by the child before the exec */
+#define SPAWN_CLOSE	1	/* close(sa_fd) */
+#define SPAWN_DUP2	2	/* dup2(sa_fd,sa_newfd) */
+#define SPAWN_OPEN	3	/* open(sa_path,sa_oflag,sa_mode) as sa_fd */
+
+struct spawn_action {
+	int sa_type;
+	int sa_fd;
+	int sa_newfd;
+	char * sa_path;
+	int sa_oflag;
+	mode_t sa_mode;
+};
+
+/* sp_flags */
+#define SPAWN_SETPGROUP		1	/* setpgid(0,sp_pgroup) */
+#define SPAWN_SETSIGMASK	2	/* the signal mask is sp_sigmask */
+#define SPAWN_SETSIGDEF		4	/* signals in sp_sigdefault get SIG_DFL */
+
+struct spawn_attr {
+	int sp_flags;
+	pid_t sp_pgroup;
+	sigset_t sp_sigmask;
+	sigset_t sp_sigdefault;
+	int sp_nr_actions;
+	struct spawn_action * sp_actions;
+};
+
+pid_t spawn(const char * filename, char ** argv, char ** envp,
+	struct spawn_attr * attr);
+
+#endif
@@ -2,6 +2,7 @@
 #define _SYS_DIRENT_H
 
 #include <limits.h>
+#include <sys/stat.h>
 
 struct dirent {
 	long		d_ino;
@@ -10,4 +11,18 @@ struct dirent {
 	char		d_name[NAME_MAX+1];
 };
 
+/*
+ * readdir() packs the entries: each one is only d_reclen bytes long,
+ * with the name nul-terminated. With READDIR_PLUS the struct stat of
+ * the entry comes first, and d_reclen covers it too.
+ */
+#define READDIR_PLUS	1
+
+struct dirent_plus {
+	struct stat	d_stat;
+	struct dirent	d_dirent;
+};
+
+int readdir(int fildes, char * buf, int count, int flags);
+
 #endif
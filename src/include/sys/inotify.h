@@ -0,0 +1,27 @@
+#ifndef _SYS_INOTIFY_H
+#define _SYS_INOTIFY_H
+
+/*
+ * read() on an inotify fd returns whole events only, and blocks until
+ * there is one (unless O_NONBLOCK). select() says when there is.
+ */
+struct inotify_event {
+	int		wd;		/* -1 for IN_Q_OVERFLOW */
+	unsigned long	mask;
+	char		name[16];	/* entry in a watched dir, or "" */
+};
+
+#define IN_MODIFY	0x0002	/* written to or truncated */
+#define IN_ATTRIB	0x0004	/* chmod, chown, utime */
+#define IN_CREATE	0x0100	/* entry added to a watched directory */
+#define IN_DELETE	0x0200	/* entry removed from it */
+#define IN_ALL_EVENTS	0x0306
+
+#define IN_Q_OVERFLOW	0x4000	/* events were lost */
+#define IN_IGNORED	0x8000	/* watch removed */
+
+int inotify_init(void);
+int inotify_add_watch(int fildes, const char * pathname, unsigned long mask);
+int inotify_rm_watch(int fildes, int wd);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef _SYS_MMAN_H
+#define _SYS_MMAN_H
+
+#include <sys/types.h>
+
+#define PROT_NONE	0
+#define PROT_READ	1
+#define PROT_WRITE	2
+#define PROT_EXEC	4
+
+#define MAP_SHARED	1	/* changes go to the file */
+#define MAP_PRIVATE	2	/* changes are private (copy-on-write) */
+#define MAP_TYPE	0x0f
+#define MAP_FIXED	0x10	/* the address has to be taken as is */
+
+#define MAP_FAILED	((void *) -1)
+
+/* msync() flags */
+#define MS_ASYNC	1	/* start the writes, don't wait */
+#define MS_INVALIDATE	2	/* accepted: mappings see writes anyway */
+#define MS_SYNC		4	/* wait until it's on the disk */
+
+void * mmap(void * addr, size_t len, int prot, int flags, int fd, off_t off);
+int munmap(void * addr, size_t len);
+int msync(void * addr, size_t len, int flags);
+
+#endif
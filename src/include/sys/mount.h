@@ -0,0 +1,12 @@
+#ifndef _SYS_MOUNT_H
+#define _SYS_MOUNT_H
+
+/* mount flags: the low bit is the old rw_flag */
+#define MS_RDONLY	1	/* mount read-only */
+#define MS_NOATIME	2	/* never update access times */
+#define MS_NODIRATIME	4	/* ... or only those of directories */
+#define MS_RELATIME	8	/* only when older than mtime/ctime or a day */
+#define MS_SYNCHRONOUS	16	/* writes are synchronous (as O_SYNC) */
+#define MS_TMPFS	32	/* mount a new tmpfs, dev_name is ignored */
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _SYS_SWAP_H
+#define _SYS_SWAP_H
+
+#define SWAP_FLAG_PREFER	0x8000	/* the priority is given */
+#define SWAP_FLAG_PRIO_MASK	0x7fff
+
+int swapon(const char * specialfile, int swap_flags);
+int swapoff(const char * specialfile);
+
+#endif
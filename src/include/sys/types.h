@@ -50,4 +50,21 @@ struct ustat {
 	char f_fpack[6];
 };
 
+struct statfs {
+	long f_type;
+	long f_bsize;
+	long f_blocks;
+	long f_bfree;
+	long f_bavail;
+	long f_files;
+	long f_ffree;
+	long f_namelen;
+};
+
+struct defrag_stat {
+	long d_blocks;		/* blocks in the file */
+	long d_before;		/* contiguous pieces before */
+	long d_after;		/* ... and after */
+};
+
 #endif
@@ -155,6 +155,21 @@
 #define __NR_swapon	87
 #define __NR_reboot	88
 #define __NR_readdir	89
+#define __NR_statfs	90
+#define __NR_fsync	91
+#define __NR_fdatasync	92
+#define __NR_kdaemon	93
+#define __NR_defrag	94
+#define __NR_inotify_init	95
+#define __NR_inotify_add_watch	96
+#define __NR_inotify_rm_watch	97
+#define __NR_mmap	98
+#define __NR_munmap	99
+#define __NR_swapoff	100
+#define __NR_vfork	101
+#define __NR_spawn	102
+#define __NR_journal	103
+#define __NR_msync	104
 
 /* XXX - _foo needs to be __foo, while __NR_bar could be _NR_bar. */
 #define _syscall0(type,name) \
@@ -245,6 +260,7 @@ volatile void exit(int status);
 volatile void _exit(int status);
 int fcntl(int fildes, int cmd, ...);
 pid_t fork(void);
+pid_t vfork(void);
 pid_t getpid(void);
 uid_t getuid(void);
 uid_t geteuid(void);
@@ -279,6 +295,12 @@ int umount(const char * specialfile);
 int uname(struct utsname * name);
 int unlink(const char * filename);
 int ustat(dev_t dev, struct ustat * ubuf);
+int statfs(const char * filename, struct statfs * buf);
+int fsync(int fildes);
+int fdatasync(int fildes);
+int kdaemon(int nr);
+int defrag(int fildes, struct defrag_stat * stat);
+int journal(int fildes);
 int utime(const char * filename, struct utimbuf * times);
 pid_t waitpid(pid_t pid,int * wait_stat,int options);
 pid_t wait(int * wait_stat);
@@ -298,5 +320,6 @@ int getgroups(int gidsetlen, gid_t *gidset);
 int setgroups(int gidsetlen, gid_t *gidset);
 int select(int width, fd_set * readfds, fd_set * writefds,
 	fd_set * exceptfds, struct timeval * timeout);
-int swapon(const char * specialfile);
+int swapon(const char * specialfile, int swap_flags);
+int swapoff(const char * specialfile);
 #endif
@@ -135,8 +135,8 @@ setup_gdt:
 
 /*
  * I put the kernel page tables right after the page directory,
- * using 4 of them to span 16 Mb of physical memory. People with
- * more than 16MB will have to expand this.
+ * using 4 of them to span 16 Mb of physical memory. mem_init() maps
+ * anything above that, up to the 64Mb that task 0 has.
  */
 .org 0x1000
 pg0:
@@ -270,7 +270,7 @@ idt:
 	.fill 256,8,0		# idt is uninitialized
 gdt:
 	.quad 0x0000000000000000	/* NULL descriptor */
-	.quad 0x00c09a0000000fff	/* 16Mb */
-	.quad 0x00c0920000000fff	/* 16Mb */
+	.quad 0x00c09a0000003fff	/* 64Mb */
+	.quad 0x00c0920000003fff	/* 64Mb */
 	.quad 0x0000000000000000	/* TEMPORARY - don't use */
 	.fill 252, 8, 0			/* space for LDT's and TSS's etc */
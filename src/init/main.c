@@ -24,6 +24,7 @@ static inline _syscall0(int,fork)
 static inline _syscall0(int,pause)
 static inline _syscall1(int,setup,void *,BIOS)
 static inline _syscall0(int,sync)
+static inline _syscall1(int,kdaemon,int,nr)
 
 #include <linux/tty.h>
 #include <linux/sched.h>
@@ -69,6 +70,7 @@ static int sprintf(char * str, const char *fmt, ...)
  * This is set up by the setup-routine at boot-time
  */
 #define EXT_MEM_K (*(unsigned short *)0x90002)
+#define ALT_MEM_K (*(unsigned long *)0x901e0)
 #define CON_ROWS ((*(unsigned short *)0x9000e) & 0xff)
 #define CON_COLS (((*(unsigned short *)0x9000e) & 0xff00) >> 8)
 #define DRIVE_INFO (*(struct drive_info *)0x90080)
@@ -138,11 +140,15 @@ void start_kernel(void)
 	envp_rc[1] = term;
 	envp_init[1] = term;
  	drive_info = DRIVE_INFO;
-	memory_end = (1<<20) + (EXT_MEM_K<<10);
+	memory_end = (ALT_MEM_K > EXT_MEM_K) ? ALT_MEM_K : EXT_MEM_K;
+/* the kernel maps all memory in task 0's part of the linear space */
+	if (memory_end > (TASK_SIZE>>10) - 1024)
+		memory_end = (TASK_SIZE>>10) - 1024;
+	memory_end = (1<<20) + (memory_end<<10);
 	memory_end &= 0xfffff000;
-	if (memory_end > 16*1024*1024)
-		memory_end = 16*1024*1024;
-	if (memory_end >= 12*1024*1024) 
+	if (memory_end >= 32*1024*1024)
+		buffer_memory_end = 8*1024*1024;
+	else if (memory_end >= 12*1024*1024)
 		buffer_memory_end = 4*1024*1024;
 	else if (memory_end >= 6*1024*1024)
 		buffer_memory_end = 2*1024*1024;
@@ -203,6 +209,16 @@ void init(void)
 	printf("%d buffers = %d bytes buffer space\n\r",NR_BUFFERS,
 		NR_BUFFERS*BLOCK_SIZE);
 	printf("Free mem: %d bytes\n\r",memory_end-main_memory_start);
+	if (!fork()) {
+		close(0);close(1);close(2);
+		setsid();
+		_exit(kdaemon(KD_TRUNCATE));
+	}
+	if (!fork()) {
+		close(0);close(1);close(2);
+		setsid();
+		_exit(kdaemon(KD_SWAP));
+	}
 #if 0
 	execve("/etc/init",argv_init,envp_init);
 	execve("/bin/init",argv_init,envp_init);
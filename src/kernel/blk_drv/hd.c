@@ -338,7 +338,7 @@ void do_hd_request(void)
 	INIT_REQUEST;
 	dev = MINOR(CURRENT->dev);
 	block = CURRENT->sector;
-	if (dev >= 5*NR_HD || block+2 > hd[dev].nr_sects) {
+	if (dev >= 5*NR_HD || block+CURRENT->nr_sectors > hd[dev].nr_sects) {
 		end_request(0);
 		goto repeat;
 	}
@@ -48,6 +48,13 @@ struct blk_dev_struct blk_dev[NR_BLK_DEV] = {
  */
 int * blk_size[NR_BLK_DEV] = { NULL, NULL, };
 
+/*
+ * max_sectors is the largest request ll_rw_direct() may hand a driver:
+ * the floppy DMA is set up for one block at a time, the harddisk takes
+ * a sector count byte.
+ */
+int max_sectors[NR_BLK_DEV] = { 0, 128, 2, 128, 0, 0, 0 };
+
 static inline void lock_buffer(struct buffer_head * bh)
 {
 	cli();
@@ -195,6 +202,51 @@ repeat:
 	schedule();
 }	
 
+/*
+ * ll_rw_direct() is for O_DIRECT: it queues one request of 'nr_sectors'
+ * straight to/from bh->b_data. The buffer head isn't from the cache (it
+ * is never hashed): it's just something for the driver to unlock when
+ * the request is done. The caller waits for that.
+ */
+void ll_rw_direct(int rw, struct buffer_head * bh, int nr_sectors)
+{
+	struct request * req;
+	unsigned int major = MAJOR(bh->b_dev);
+
+	bh->b_uptodate = 0;
+	bh->b_lock = 0;			/* the caller waits on it */
+	if (major >= NR_BLK_DEV || !(blk_dev[major].request_fn) ||
+	    nr_sectors > max_sectors[major]) {
+		printk("ll_rw_direct: bad request for device %04x\n\r",bh->b_dev);
+		return;
+	}
+	if (rw!=READ && rw!=WRITE)
+		panic("Bad block dev command, must be R/W");
+	bh->b_lock = 1;
+repeat:
+	if (rw == READ)
+		req = request+NR_REQUEST;
+	else
+		req = request+((NR_REQUEST*2)/3);
+	while (--req >= request)
+		if (req->dev<0)
+			break;
+	if (req < request) {
+		sleep_on(&wait_for_request);
+		goto repeat;
+	}
+	req->dev = bh->b_dev;
+	req->cmd = rw;
+	req->errors = 0;
+	req->sector = bh->b_blocknr<<1;
+	req->nr_sectors = nr_sectors;
+	req->buffer = bh->b_data;
+	req->waiting = NULL;
+	req->bh = bh;
+	req->next = NULL;
+	add_request(major+blk_dev,req);
+}
+
 void ll_rw_block(int rw, struct buffer_head * bh)
 {
 	unsigned int major;
@@ -19,6 +19,101 @@
 
 char	*rd_start;
 int	rd_length = 0;
+static int rd_sizes[2] = {0, };		/* only minor 1 is the ram disk */
+
+/*
+ * A compressed image has a crd_header in block 256 of the floppy
+ * instead of a minix file system, followed by c_blocks+1 offsets
+ * (from the start of the header): block n of the file system is the
+ * c_index[n]..c_index[n+1] bytes. An empty one is a block of zeroes,
+ * one of BLOCK_SIZE bytes is stored as is, anything else is LZSS: a
+ * flag byte for the next 8 items (lsb first), 1 for a literal byte,
+ * 0 for two bytes of 12-bit distance back and 4-bit length-3. Every
+ * block is packed on its own, so any of them can be unpacked on its
+ * own: only the compressed image is loaded, and blocks are unpacked
+ * as the buffer cache asks for them. The ram disk is read-only then.
+ * bin/crdpack makes such an image out of a minix one.
+ */
+#define CRD_MAGIC	0x31445243	/* "CRD1" */
+
+struct crd_header {
+	unsigned long c_magic;
+	unsigned long c_blocks;		/* blocks in the file system */
+	unsigned long c_size;		/* bytes in the image, index included */
+};
+
+static unsigned long * rd_index = NULL;
+static unsigned long rd_blocks = 0;
+
+/*
+ * Every block has to lie inside the image, after the index: offsets
+ * never go down, and the last one is the end.
+ */
+static int rd_check_index(struct crd_header * h)
+{
+	unsigned long i;
+
+	if (h->c_blocks >= h->c_size / sizeof (long) ||
+	    rd_index[0] < sizeof (*h) + (h->c_blocks+1) * sizeof (long))
+		return 0;
+	for (i = 0 ; i < h->c_blocks ; i++)
+		if (rd_index[i] > rd_index[i+1])
+			return 0;
+	return rd_index[h->c_blocks] <= h->c_size;
+}
+
+static int rd_unpack(int block, char * buf)
+{
+	unsigned char * src, * end;
+	char * p = buf;
+	int flags = 0, off, n;
+
+	if (block >= rd_blocks)
+		return 0;
+	src = (unsigned char *) rd_start + rd_index[block];
+	end = (unsigned char *) rd_start + rd_index[block+1];
+	if (src == end) {
+		memset(buf,0,BLOCK_SIZE);
+		return 1;
+	}
+	if (end - src == BLOCK_SIZE) {
+		memcpy(buf,src,BLOCK_SIZE);
+		return 1;
+	}
+	while (src < end && p < buf+BLOCK_SIZE) {
+		if (!((flags >>= 1) & 0x100))
+			flags = *(src++) | 0xff00;
+		if (flags & 1) {
+			*(p++) = *(src++);
+			continue;
+		}
+		if (src+2 > end)
+			return 0;
+		off = src[0] | ((src[1] & 0xf0) << 4);
+		n = (src[1] & 0x0f) + 3;
+		src += 2;
+		if (!off || off > p-buf || n > buf+BLOCK_SIZE-p)
+			return 0;
+		while (n--) {
+			*p = *(p-off);
+			p++;
+		}
+	}
+	return p == buf+BLOCK_SIZE;
+}
+
+static int do_rd_unpack(void)
+{
+	int	i;
+
+	if (CURRENT->cmd != READ || (CURRENT->sector & 1))
+		return 0;
+	for (i = 0 ; i < CURRENT->nr_sectors ; i += 2)
+		if (!rd_unpack((CURRENT->sector + i) >> 1,
+		    CURRENT->buffer + (i << 9)))
+			return 0;
+	return 1;
+}
 
 void do_rd_request(void)
 {
@@ -26,6 +121,10 @@ void do_rd_request(void)
 	char	*addr;
 
 	INIT_REQUEST;
+	if (rd_index) {
+		end_request(MINOR(CURRENT->dev) == 1 && do_rd_unpack());
+		goto repeat;
+	}
 	addr = rd_start + (CURRENT->sector << 9);
 	len = CURRENT->nr_sectors << 9;
 	if ((MINOR(CURRENT->dev) != 1) || (addr+len > rd_start+rd_length)) {
@@ -57,6 +156,8 @@ long rd_init(long mem_start, int length)
 	blk_dev[MAJOR_NR].request_fn = DEVICE_REQUEST;
 	rd_start = (char *) mem_start;
 	rd_length = length;
+	rd_sizes[1] = length >> BLOCK_SIZE_BITS;
+	blk_size[MAJOR_NR] = rd_sizes;
 	cp = rd_start;
 	for (i=0; i < length; i++)
 		*cp++ = '\0';
@@ -72,6 +173,7 @@ void rd_load(void)
 {
 	struct buffer_head *bh;
 	struct super_block	s;
+	struct crd_header	h;
 	int		block = 256;	/* Start at block 256 */
 	int		i = 1;
 	int		nblocks;
@@ -83,17 +185,28 @@ void rd_load(void)
 		(int) rd_start);
 	if (MAJOR(ROOT_DEV) != 2)
 		return;
-	bh = breada(ROOT_DEV,block+1,block,block+2,-1);
+	bh = breada(ROOT_DEV,block,block+1,block+2,-1);
 	if (!bh) {
 		printk("Disk error while looking for ramdisk!\n");
 		return;
 	}
-	*((struct d_super_block *) &s) = *((struct d_super_block *) bh->b_data);
+	h = *(struct crd_header *) bh->b_data;
 	brelse(bh);
-	if (s.s_magic != SUPER_MAGIC)
-		/* No ram disk image present, assume normal floppy boot */
-		return;
-	nblocks = s.s_nzones << s.s_log_zone_size;
+	if (h.c_magic == CRD_MAGIC)
+		nblocks = (h.c_size + BLOCK_SIZE-1) >> BLOCK_SIZE_BITS;
+	else {
+		if (!(bh = bread(ROOT_DEV,block+1))) {
+			printk("Disk error while looking for ramdisk!\n");
+			return;
+		}
+		*((struct d_super_block *) &s) =
+			*((struct d_super_block *) bh->b_data);
+		brelse(bh);
+		if (s.s_magic != SUPER_MAGIC)
+			/* No ram disk image present, assume normal floppy boot */
+			return;
+		nblocks = s.s_nzones << s.s_log_zone_size;
+	}
 	if (nblocks > (rd_length >> BLOCK_SIZE_BITS)) {
 		printk("Ram disk image too big!  (%d blocks, %d avail)\n", 
 			nblocks, rd_length >> BLOCK_SIZE_BITS);
@@ -121,5 +234,18 @@ void rd_load(void)
 		i++;
 	}
 	printk("\010\010\010\010\010done \n");
+	if (h.c_magic == CRD_MAGIC) {
+		rd_index = (unsigned long *) (rd_start + sizeof (h));
+		if (!rd_check_index(&h)) {
+			printk("Bad compressed ram disk index\n");
+			rd_index = NULL;
+			return;
+		}
+		rd_blocks = h.c_blocks;
+		rd_sizes[1] = h.c_blocks;
+		printk("Compressed ram disk: %d blocks, mounted read-only\n",
+			h.c_blocks);
+		root_mountflags |= MS_RDONLY;
+	}
 	ROOT_DEV=0x0101;
 }
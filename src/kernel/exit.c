@@ -264,6 +264,8 @@ volatile void do_exit(long code)
 	struct task_struct *p;
 	int i;
 
+	vfork_release();
+	exit_mmap();
 	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
 	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
 	for (i=0 ; i<NR_OPEN ; i++)
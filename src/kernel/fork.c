@@ -18,6 +18,7 @@
 #include <asm/system.h>
 
 extern void write_verify(unsigned long address);
+extern void spawn_child(void);
 
 long last_pid=0;
 
@@ -64,8 +65,14 @@ int copy_mem(int nr, struct task_struct * p)
  *  Ok, this is the main fork-routine. It copies the system process
  * information (task[nr]) and sets up the necessary registers. It
  * also copies the data segment in it's entirety.
+ *
+ * With COPY_VFORK nothing of the memory is copied: the child runs in
+ * its parent's segment, and the parent sleeps until the child has
+ * called exec() or exit(). A COPY_SPAWN child doesn't even return to
+ * user mode before that: it starts in the kernel, in do_spawn(), with
+ * the system call frame of its parent on its stack.
  */
-int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
+int copy_process(int clone_flags,int nr,long ebp,long edi,long esi,long gs,long none,
 		long ebx,long ecx,long edx, long orig_eax, 
 		long fs,long es,long ds,
 		long eip,long cs,long eflags,long esp,long ss)
@@ -73,6 +80,8 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	struct task_struct *p;
 	int i;
 	struct file **f;
+	struct mmap_struct *m;
+	long * stack;
 
 	p = (struct task_struct *) get_free_page();
 	if (!p)
@@ -110,9 +119,33 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	p->tss.gs = gs & 0xffff;
 	p->tss.ldt = _LDT(nr);
 	p->tss.trace_bitmap = 0x80000000;
+	if (clone_flags & COPY_SPAWN) {
+		stack = (long *) p->tss.esp0;
+		*--stack = ss & 0xffff;
+		*--stack = esp;
+		*--stack = eflags;
+		*--stack = cs & 0xffff;
+		*--stack = eip;
+		*--stack = ds & 0xffff;
+		*--stack = es & 0xffff;
+		*--stack = fs & 0xffff;
+		*--stack = orig_eax;
+		*--stack = edx;
+		*--stack = ecx;
+		*--stack = ebx;
+		*--stack = 0;		/* eax */
+		p->tss.eip = (long) spawn_child;
+		p->tss.esp = (long) stack;
+		p->tss.cs = 0x08;
+		p->tss.ss = p->tss.ds = p->tss.es = 0x10;
+	}
+	p->flags &= ~PF_VFORK;
+	p->vfork_wait = NULL;
+	if (clone_flags & COPY_VFORK)
+		p->flags |= PF_VFORK;
 	if (last_task_used_math == current)
 		__asm__("clts ; fnsave %0 ; frstor %0"::"m"(p->tss.i387));
-	if (copy_mem(nr, p)) {
+	if (!(clone_flags & COPY_VFORK) && copy_mem(nr, p)) {
 		task[nr] = NULL;
 		free_page((long) p);
 		return -EAGAIN;
@@ -130,6 +163,9 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 		current->executable->i_count++;
 	if (current->library)
 		current->library->i_count++;
+	for (m=p->mmap; m < p->mmap+NR_MMAP; m++)
+		if (m->inode)
+			m->inode->i_count++;
 	set_tss_desc(gdt+(nr<<1)+FIRST_TSS_ENTRY, &(p->tss));
 	set_ldt_desc(gdt+(nr<<1)+FIRST_LDT_ENTRY, &(p->ldt));
 	p->p_pptr = current;
@@ -141,8 +177,39 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	}
 	current->p_cptr = p;
 	task[nr] = p;	/* do this last, just in case */
-	
-	return last_pid;
+	i = p->pid;
+	while (p->flags & PF_VFORK)
+		sleep_on(&p->vfork_wait);
+	return i;
+}
+
+/*
+ * Called by exec() and exit(): a vfork()ed child moves to its own slot
+ * (still empty), and lets the parent go on. The mmap()ed areas were
+ * only borrowed, too.
+ */
+void vfork_release(void)
+{
+	struct mmap_struct * m;
+	unsigned long base;
+	int nr;
+
+	if (!(current->flags & PF_VFORK))
+		return;
+	for (m = current->mmap ; m < current->mmap+NR_MMAP ; m++) {
+		iput(m->inode);
+		m->inode = NULL;
+	}
+	for (nr = 0 ; nr < NR_TASKS ; nr++)
+		if (task[nr] == current)
+			break;
+	base = nr * TASK_SIZE;
+	current->start_code = base;
+	set_base(current->ldt[1],base);
+	set_base(current->ldt[2],base);
+	__asm__("pushl $0x17\n\tpop %%fs"::);
+	current->flags &= ~PF_VFORK;
+	wake_up(&current->vfork_wait);
 }
 
 int find_empty_process(void)
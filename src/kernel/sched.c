@@ -173,6 +173,8 @@ void schedule(void)
 
 int sys_pause(void)
 {
+	if (current == &(init_task.task))
+		fill_zero_pages();
 	current->state = TASK_INTERRUPTIBLE;
 	schedule();
 	return 0;
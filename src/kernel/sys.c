@@ -55,6 +55,24 @@ int sys_prof()
 	return -ENOSYS;
 }
 
+int sys_kdaemon(int nr)
+{
+	if (!suser())
+		return -EPERM;
+	switch (nr) {
+		case KD_TRUNCATE:
+			return truncate_daemon();
+		case KD_SWAP:
+			return swap_daemon();
+	}
+	return -EINVAL;
+}
+
+int sys_reboot()
+{
+	return -ENOSYS;
+}
+
 /*
  * This is done BSD-style, with no consideration of the saved gid, except
  * that if you set the effective gid, it sets the saved gid too.  This 
@@ -222,9 +240,15 @@ int sys_times(struct tms * tbuf)
 
 int sys_brk(unsigned long end_data_seg)
 {
+	struct mmap_struct * m;
+
 	if (end_data_seg >= current->end_code &&
-	    end_data_seg < current->start_stack - 16384)
+	    end_data_seg < current->start_stack - 16384) {
+		for (m = current->mmap ; m < current->mmap+NR_MMAP ; m++)
+			if (m->inode && end_data_seg > m->start)
+				return current->brk;
 		current->brk = end_data_seg;
+	}
 	return current->brk;
 }
 
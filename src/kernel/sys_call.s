@@ -69,6 +69,7 @@ ENOSYS = 38
  * strange reason. Urgel. Now I just ignore them.
  */
 .globl system_call,sys_fork,timer_interrupt,sys_execve
+.globl sys_vfork,sys_spawn,spawn_child
 .globl hd_interrupt,floppy_interrupt,parallel_interrupt
 .globl device_not_available, coprocessor_error
 
@@ -220,17 +221,43 @@ sys_execve:
 
 .align 4
 sys_fork:
+	xorl %ecx,%ecx			# no COPY_ flags
+	jmp 1f
+
+.align 4
+sys_vfork:
+	movl $1,%ecx			# COPY_VFORK
+	jmp 1f
+
+.align 4
+sys_spawn:
+	movl $3,%ecx			# COPY_VFORK | COPY_SPAWN
+1:	pushl %ecx
 	call find_empty_process
+	popl %ecx
 	testl %eax,%eax
-	js 1f
+	js 2f
 	push %gs
 	pushl %esi
 	pushl %edi
 	pushl %ebp
 	pushl %eax
+	pushl %ecx
 	call copy_process
-	addl $20,%esp
-1:	ret
+	addl $24,%esp
+2:	ret
+
+/*
+ * A spawn()ed child starts here, on a copy of its parent's system
+ * call frame. do_spawn() only returns once the exec has worked.
+ */
+.align 4
+spawn_child:
+	lea EIP(%esp),%eax
+	pushl %eax
+	call do_spawn
+	addl $4,%esp
+	jmp ret_from_sys_call
 
 hd_interrupt:
 	pushl %eax
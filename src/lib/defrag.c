@@ -0,0 +1,10 @@
+/*
+ *  linux/lib/defrag.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+
+_syscall2(int,defrag,int,fd,struct defrag_stat *,stat)
@@ -0,0 +1,13 @@
+/*
+ *  linux/lib/inotify.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/inotify.h>
+
+_syscall0(int,inotify_init)
+_syscall3(int,inotify_add_watch,int,fd,const char *,pathname,unsigned long,mask)
+_syscall2(int,inotify_rm_watch,int,fd,int,wd)
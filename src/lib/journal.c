@@ -0,0 +1,10 @@
+/*
+ *  linux/lib/journal.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+
+_syscall1(int,journal,int,fd)
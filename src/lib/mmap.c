@@ -0,0 +1,36 @@
+/*
+ *  linux/lib/mmap.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/mman.h>
+
+/*
+ * mmap() has six arguments: they are passed in an array.
+ */
+void * mmap(void * addr, size_t len, int prot, int flags, int fd, off_t off)
+{
+	unsigned long buffer[6];
+	long __res;
+
+	buffer[0] = (unsigned long) addr;
+	buffer[1] = len;
+	buffer[2] = prot;
+	buffer[3] = flags;
+	buffer[4] = fd;
+	buffer[5] = off;
+	__asm__ volatile ("int $0x80"
+		: "=a" (__res)
+		: "0" (__NR_mmap),"b" ((long) buffer)
+		: "memory");
+	if (__res >= 0)
+		return (void *) __res;
+	errno = -__res;
+	return MAP_FAILED;
+}
+
+_syscall2(int,munmap,void *,addr,size_t,len)
+_syscall3(int,msync,void *,addr,size_t,len,int,flags)
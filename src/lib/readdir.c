@@ -0,0 +1,31 @@
+/*
+ *  linux/lib/readdir.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/dirent.h>
+
+/*
+ * readdir() has four arguments: they are passed in an array.
+ */
+int readdir(int fildes, char * buf, int count, int flags)
+{
+	unsigned long buffer[4];
+	long __res;
+
+	buffer[0] = fildes;
+	buffer[1] = (unsigned long) buf;
+	buffer[2] = count;
+	buffer[3] = flags;
+	__asm__ volatile ("int $0x80"
+		: "=a" (__res)
+		: "0" (__NR_readdir),"b" ((long) buffer)
+		: "memory");
+	if (__res >= 0)
+		return __res;
+	errno = -__res;
+	return -1;
+}
@@ -0,0 +1,32 @@
+/*
+ *  linux/lib/spawn.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <spawn.h>
+
+/*
+ * spawn() has four arguments: they are passed in an array.
+ */
+pid_t spawn(const char * filename, char ** argv, char ** envp,
+	struct spawn_attr * attr)
+{
+	unsigned long buffer[4];
+	long __res;
+
+	buffer[0] = (unsigned long) filename;
+	buffer[1] = (unsigned long) argv;
+	buffer[2] = (unsigned long) envp;
+	buffer[3] = (unsigned long) attr;
+	__asm__ volatile ("int $0x80"
+		: "=a" (__res)
+		: "0" (__NR_spawn),"b" ((long) buffer)
+		: "memory");
+	if (__res >= 0)
+		return __res;
+	errno = -__res;
+	return -1;
+}
@@ -0,0 +1,12 @@
+/*
+ *  linux/lib/swap.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/swap.h>
+
+_syscall2(int,swapon,const char *,specialfile,int,swap_flags)
+_syscall1(int,swapoff,const char *,specialfile)
@@ -0,0 +1,30 @@
+/*
+ *  linux/lib/vfork.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+
+#define __str(x) #x
+#define str(x) __str(x)
+
+/*
+ * vfork() can't be an ordinary function: the child returns from it
+ * first and goes on using the same stack, so the parent's return
+ * address is likely gone by the time it gets to run. It's kept in
+ * %ecx instead, which the system call leaves alone.
+ */
+__asm__(".globl vfork\n"
+	"vfork:\n\t"
+	"popl %ecx\n\t"
+	"movl $" str(__NR_vfork) ",%eax\n\t"
+	"int $0x80\n\t"
+	"pushl %ecx\n\t"
+	"testl %eax,%eax\n\t"
+	"jns 1f\n\t"
+	"negl %eax\n\t"
+	"movl %eax,errno\n\t"
+	"movl $-1,%eax\n"
+	"1:\tret");
@@ -0,0 +1,558 @@
+/*
+ *  linux/mm/filemap.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * The page cache: file pages indexed by (device, inode, offset). They
+ * are read straight into the page (blocks that happen to be in the
+ * buffer cache are copied from there), so a file page is in memory once
+ * however many processes map it. Demand-loaded executables and mmap()
+ * both get their pages here. The offset only has to be block aligned,
+ * as executable pages start after the 1kB header.
+ *
+ * A cache page holds a mem_map[] reference of its own. When that is the
+ * only one left, the page can go whenever memory is short.
+ *
+ * A page is in the cache, locked, while it is being read: a write() or
+ * truncate in the meantime marks it stale, and it is read again.
+ *
+ * This is also how the text and library pages of running programs are
+ * shared: there is an entry for every page of memory, so every file
+ * page that is mapped anywhere can be found here, and a fault on it is
+ * a hash lookup however many processes there are.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+
+static struct cache_page {
+	unsigned short c_dev;
+	unsigned short c_ino;
+	unsigned long c_offset;
+	unsigned long c_page;		/* 0 if unused */
+	unsigned char c_lock;		/* being read */
+	unsigned char c_stale;		/* ... and changed meanwhile */
+	struct task_struct * c_wait;
+	struct cache_page * c_next;	/* hash chain, or the free list */
+} * cache_table;
+
+static struct cache_page ** cache_hash;
+static struct cache_page * free_cache = NULL;
+static int nr_cache, nr_cache_hash;
+
+#define _hashfn(dev,ino,offset) \
+	(((unsigned) ((dev)^(ino)^((offset)>>BLOCK_SIZE_BITS)))%nr_cache_hash)
+#define hash(dev,ino,offset) cache_hash[_hashfn(dev,ino,offset)]
+
+/*
+ * Called by mem_init(): the table has as many entries as there are
+ * pages, so it never fills up with pages that are in use.
+ */
+unsigned long page_cache_init(unsigned long start_mem)
+{
+	int i;
+
+	nr_cache = PAGING_PAGES;
+	nr_cache_hash = (PAGING_PAGES >> 2) | 1;
+	cache_table = (struct cache_page *) start_mem;
+	start_mem += nr_cache * sizeof (struct cache_page);
+	cache_hash = (struct cache_page **) start_mem;
+	start_mem += nr_cache_hash * sizeof (struct cache_page *);
+	for (i = 0 ; i < nr_cache_hash ; i++)
+		cache_hash[i] = NULL;
+	for (i = nr_cache-1 ; i >= 0 ; i--) {
+		cache_table[i].c_page = 0;
+		cache_table[i].c_lock = 0;
+		cache_table[i].c_wait = NULL;
+		cache_table[i].c_next = free_cache;
+		free_cache = cache_table + i;
+	}
+	return start_mem;
+}
+
+static struct cache_page * find_page(int dev, int ino, unsigned long offset)
+{
+	struct cache_page * p;
+
+	for (p = hash(dev,ino,offset) ; p ; p = p->c_next)
+		if (p->c_dev == dev && p->c_ino == ino && p->c_offset == offset)
+			return p;
+	return NULL;
+}
+
+static void remove_page(struct cache_page * p)
+{
+	struct cache_page ** pp;
+
+	for (pp = &hash(p->c_dev,p->c_ino,p->c_offset) ; *pp ; pp = &(*pp)->c_next)
+		if (*pp == p) {
+			*pp = p->c_next;
+			break;
+		}
+	free_page(p->c_page);
+	p->c_page = 0;
+	p->c_next = free_cache;
+	free_cache = p;
+}
+
+/*
+ * Drops one page nobody else uses: get_free_page() tries this before it
+ * starts swapping.
+ */
+int shrink_page_cache(void)
+{
+	static int hand = 0;
+	struct cache_page * p;
+	int i;
+
+	for (i = 0 ; i < nr_cache ; i++) {
+		p = cache_table + hand;
+		if (++hand >= nr_cache)
+			hand = 0;
+		if (p->c_page && mem_map[MAP_NR(p->c_page)] == 1) {
+			remove_page(p);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * The file is truncated or gone (ino 0: the whole device is): forget
+ * its pages. Mapped ones stay with the processes that map them. One
+ * that is being read is left to its reader.
+ */
+void invalidate_cache(int dev, int ino)
+{
+	struct cache_page * p;
+
+	for (p = cache_table ; p < cache_table+nr_cache ; p++)
+		if (p->c_page && p->c_dev == dev && (!ino || p->c_ino == ino)) {
+			if (p->c_lock)
+				p->c_stale = 1;
+			else
+				remove_page(p);
+		}
+}
+
+/*
+ * write() goes through the buffer cache: the same bytes go into the
+ * cached pages of the file as well, or mappings wouldn't see them.
+ * 'buf' is in user space (or is the page itself, for a write-back).
+ */
+void update_vm_cache(struct m_inode * inode, unsigned long pos,
+	char * buf, int count)
+{
+	struct cache_page * p;
+	unsigned long offset, start, end;
+	char * to;
+
+	if (count <= 0)
+		return;
+	offset = pos & ~(BLOCK_SIZE-1);
+	offset = (offset < PAGE_SIZE) ? 0 : offset - PAGE_SIZE + BLOCK_SIZE;
+	for ( ; offset < pos+count ; offset += BLOCK_SIZE) {
+		if (!(p = find_page(inode->i_dev,inode->i_num,offset)))
+			continue;
+		if (p->c_lock) {
+			p->c_stale = 1;
+			continue;
+		}
+		start = (pos > offset) ? pos : offset;
+		end = (pos+count < offset+PAGE_SIZE) ? pos+count : offset+PAGE_SIZE;
+		to = (char *) p->c_page + start - offset;
+		if (to == buf + start - pos)
+			continue;
+		for ( ; start < end ; start++)
+			*(to++) = get_fs_byte(buf + start - pos);
+	}
+}
+
+static int read_page(struct m_inode * inode, unsigned long offset,
+	unsigned long page)
+{
+	struct buffer_head bh[PAGE_SIZE/BLOCK_SIZE], * cbh;
+	int i, nr, error = 0;
+	char * p = (char *) page;
+
+	for (i = 0 ; i < PAGE_SIZE/BLOCK_SIZE ; i++, p += BLOCK_SIZE) {
+		bh[i].b_dev = 0;
+		if (offset + i*BLOCK_SIZE >= inode->i_size ||
+		    !(nr = inode->i_op->bmap(inode,(offset>>BLOCK_SIZE_BITS)+i))) {
+			memset(p,0,BLOCK_SIZE);
+			continue;
+		}
+		if (cbh = get_hash_table(inode->i_dev,nr)) {
+			if (cbh->b_uptodate) {
+				memcpy(p,cbh->b_data,BLOCK_SIZE);
+				brelse(cbh);
+				continue;
+			}
+			brelse(cbh);
+		}
+		bh[i].b_data = p;
+		bh[i].b_dev = inode->i_dev;
+		bh[i].b_blocknr = nr;
+		bh[i].b_count = 1;
+		bh[i].b_lock = 0;
+		bh[i].b_uptodate = 0;
+		bh[i].b_wait = NULL;
+		ll_rw_direct(READ,bh+i,2);
+	}
+	for (i = 0 ; i < PAGE_SIZE/BLOCK_SIZE ; i++) {
+		if (!bh[i].b_dev)
+			continue;
+		cli();
+		while (bh[i].b_lock)
+			sleep_on(&bh[i].b_wait);
+		sti();
+		if (!bh[i].b_uptodate)
+			error = -EIO;
+	}
+	if (inode->i_size > offset && inode->i_size < offset+PAGE_SIZE)
+		memset((char *) page + inode->i_size - offset,0,
+			offset + PAGE_SIZE - inode->i_size);
+	return error;
+}
+
+/*
+ * Returns the page of 'inode' at 'offset', with a reference for the
+ * caller. 0 means no memory or an I/O error.
+ */
+unsigned long get_cache_page(struct m_inode * inode, unsigned long offset)
+{
+	struct cache_page * p;
+	unsigned long page;
+	int error;
+
+repeat:
+	if (p = find_page(inode->i_dev,inode->i_num,offset)) {
+		if (p->c_lock) {
+			sleep_on(&p->c_wait);
+			goto repeat;
+		}
+		mem_map[MAP_NR(p->c_page)]++;
+		return p->c_page;
+	}
+	if (!(page = __get_free_page()))
+		return 0;
+/* somebody else may have read it while we slept */
+	if (find_page(inode->i_dev,inode->i_num,offset)) {
+		free_page(page);
+		goto repeat;
+	}
+	if (!(p = free_cache) && (!shrink_page_cache() || !(p = free_cache))) {
+		if (read_page(inode,offset,page)) {
+			free_page(page);
+			return 0;
+		}
+		return page;		/* not cached, but it'll do */
+	}
+	free_cache = p->c_next;
+	p->c_dev = inode->i_dev;
+	p->c_ino = inode->i_num;
+	p->c_offset = offset;
+	p->c_page = page;
+	p->c_lock = 1;
+	p->c_next = hash(p->c_dev,p->c_ino,offset);
+	hash(p->c_dev,p->c_ino,offset) = p;
+	mem_map[MAP_NR(page)]++;
+	do {
+		p->c_stale = 0;
+		error = read_page(inode,offset,page);
+	} while (!error && p->c_stale);
+	p->c_lock = 0;
+	wake_up(&p->c_wait);
+	if (error) {
+		remove_page(p);
+		free_page(page);
+		return 0;
+	}
+	return page;
+}
+
+struct mmap_struct * find_mmap(struct task_struct * tsk, unsigned long addr)
+{
+	struct mmap_struct * m;
+
+	for (m = tsk->mmap ; m < tsk->mmap+NR_MMAP ; m++)
+		if (m->inode && addr >= m->start && addr < m->end)
+			return m;
+	return NULL;
+}
+
+/*
+ * A dirty page of a shared mapping goes back through the file's write(),
+ * which also keeps the page cache up to date. It's never extended.
+ */
+static void write_page(struct m_inode * inode, unsigned long offset,
+	unsigned long page)
+{
+	struct file file;
+	unsigned long old_fs;
+	int count;
+
+	if (offset >= inode->i_size)
+		return;
+	if ((count = inode->i_size - offset) > PAGE_SIZE)
+		count = PAGE_SIZE;
+	file.f_mode = 2;
+	file.f_flags = 0;
+	file.f_count = 1;
+	file.f_inode = inode;
+	file.f_pos = offset;
+	old_fs = get_fs();
+	set_fs(get_ds());
+	inode->i_op->default_file_ops->write(inode,&file,(char *) page,count);
+	set_fs(old_fs);
+}
+
+/*
+ * The page table entry of 'addr' in the current process, NULL if there
+ * is no page table. The table is made our own first.
+ */
+static unsigned long * get_pte(unsigned long addr)
+{
+	unsigned long dir;
+
+	addr += get_base(current->ldt[2]);
+	dir = *(unsigned long *) ((addr>>20) & 0xffc);
+	if (!(dir & 1))
+		return NULL;
+	if (!(dir & 2)) {
+		if (!unshare_page_table(addr))
+			oom();
+		dir = *(unsigned long *) ((addr>>20) & 0xffc);
+	}
+	return (unsigned long *) ((dir & 0xfffff000) + ((addr>>10) & 0xffc));
+}
+
+/*
+ * Takes the pages start..end of 'm' out of the page tables, writing
+ * back the dirty ones of a shared mapping.
+ */
+static void unmap_pages(struct mmap_struct * m, unsigned long start,
+	unsigned long end)
+{
+	unsigned long * pte, page;
+
+	for ( ; start < end ; start += PAGE_SIZE) {
+		if (!(pte = get_pte(start)) || !(page = *pte))
+			continue;
+		*pte = 0;
+		if (!(page & 1)) {
+			swap_free(page>>1);
+			continue;
+		}
+		if ((m->flags & MAP_SHARED) && (page & PAGE_DIRTY))
+			write_page(m->inode,m->offset + start - m->start,
+				page & 0xfffff000);
+		free_page(page & 0xfffff000);
+		current->rss--;
+	}
+	invalidate();
+}
+
+/*
+ * Find 'len' bytes below MMAP_TOP (and above the brk) nothing maps.
+ */
+static unsigned long get_unmapped_area(unsigned long len)
+{
+	unsigned long addr = MMAP_TOP;
+	struct mmap_struct * m;
+
+repeat:
+	if (addr < len || addr - len < current->brk)
+		return 0;
+	for (m = current->mmap ; m < current->mmap+NR_MMAP ; m++)
+		if (m->inode && m->start < addr && m->end > addr - len) {
+			addr = m->start;
+			goto repeat;
+		}
+	return addr - len;
+}
+
+static int do_mmap(unsigned long addr, unsigned long len, int prot,
+	int flags, unsigned int fd, unsigned long off)
+{
+	struct mmap_struct * m, * free = NULL;
+	struct file * file;
+	struct m_inode * inode;
+
+	if (fd >= NR_OPEN || !(file = current->filp[fd]) ||
+	    !(inode = file->f_inode))
+		return -EBADF;
+	if (!S_ISREG(inode->i_mode) || !inode->i_op->bmap)
+		return -ENODEV;
+	if (!len || (off & (BLOCK_SIZE-1)) || len > MMAP_TOP)
+		return -EINVAL;
+	if (!(file->f_mode & 1))
+		return -EACCES;
+	switch (flags & MAP_TYPE) {
+		case MAP_SHARED:
+			if ((prot & PROT_WRITE) && !(file->f_mode & 2))
+				return -EACCES;
+		case MAP_PRIVATE:
+			break;
+		default:
+			return -EINVAL;
+	}
+	len = (len + PAGE_SIZE-1) & ~(PAGE_SIZE-1);
+	for (m = current->mmap ; m < current->mmap+NR_MMAP ; m++) {
+		if (!m->inode) {
+			if (!free)
+				free = m;
+			continue;
+		}
+		if ((flags & MAP_FIXED) && m->start < addr+len && m->end > addr)
+			return -EINVAL;
+	}
+	if (!free)
+		return -ENOMEM;
+	if (flags & MAP_FIXED) {
+		if ((addr & (PAGE_SIZE-1)) || addr < current->brk ||
+		    addr + len > MMAP_TOP)
+			return -EINVAL;
+	} else if (!(addr = get_unmapped_area(len)))
+		return -ENOMEM;
+	free->start = addr;
+	free->end = addr + len;
+	free->offset = off;
+	free->prot = prot;
+	free->flags = flags;
+	free->inode = inode;
+	inode->i_count++;
+	return addr;
+}
+
+/*
+ * Six arguments don't fit in the registers: the library passes them in
+ * an array.
+ */
+int sys_mmap(unsigned long * buffer)
+{
+	unsigned long a[6];
+	int i;
+
+	for (i = 0 ; i < 6 ; i++)
+		a[i] = get_fs_long(buffer+i);
+	return do_mmap(a[0],a[1],a[2],a[3],a[4],a[5]);
+}
+
+int sys_munmap(unsigned long addr, unsigned long len)
+{
+	struct mmap_struct * m, * free;
+	unsigned long end;
+
+	if ((addr & (PAGE_SIZE-1)) || !len || len > TASK_SIZE)
+		return -EINVAL;
+	end = (addr + len + PAGE_SIZE-1) & ~(PAGE_SIZE-1);
+	for (m = current->mmap ; m < current->mmap+NR_MMAP ; m++) {
+		if (!m->inode || m->start >= end || m->end <= addr)
+			continue;
+		if (m->start < addr && m->end > end) {
+/* a hole in the middle: the top part becomes a mapping of its own */
+			for (free = current->mmap ; free < current->mmap+NR_MMAP ; free++)
+				if (!free->inode)
+					break;
+			if (free >= current->mmap+NR_MMAP)
+				return -ENOMEM;
+			*free = *m;
+			free->start = end;
+			free->offset += end - m->start;
+			m->inode->i_count++;
+			unmap_pages(m,addr,end);
+			m->end = addr;
+			continue;
+		}
+		if (m->start < addr) {
+			unmap_pages(m,addr,m->end);
+			m->end = addr;
+		} else if (m->end > end) {
+			unmap_pages(m,m->start,end);
+			m->offset += end - m->start;
+			m->start = end;
+		} else {
+			unmap_pages(m,m->start,m->end);
+			iput(m->inode);
+			m->inode = NULL;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Writes back the dirty pages start..end of a shared mapping. They are
+ * write protected again, so the next write marks them dirty again.
+ */
+static void sync_pages(struct mmap_struct * m, unsigned long start,
+	unsigned long end)
+{
+	unsigned long * pte, page;
+
+	for ( ; start < end ; start += PAGE_SIZE) {
+		if (!(pte = get_pte(start)) || !((page = *pte) & PAGE_PRESENT))
+			continue;
+		if (!(page & PAGE_DIRTY))
+			continue;
+		*pte &= ~(PAGE_DIRTY | PAGE_RW);
+		invalidate();
+		write_page(m->inode,m->offset + start - m->start,
+			page & 0xfffff000);
+	}
+}
+
+/*
+ * Without msync() the changes to a shared mapping only reach the file
+ * at munmap(), exit() or exec(). MS_SYNC also waits for the disk.
+ */
+int sys_msync(unsigned long addr, unsigned long len, int flags)
+{
+	struct mmap_struct * m;
+	struct m_inode * inode;
+	unsigned long end;
+
+	if ((addr & (PAGE_SIZE-1)) || len > TASK_SIZE ||
+	    (flags & ~(MS_ASYNC|MS_INVALIDATE|MS_SYNC)) ||
+	    ((flags & MS_ASYNC) && (flags & MS_SYNC)))
+		return -EINVAL;
+	end = (addr + len + PAGE_SIZE-1) & ~(PAGE_SIZE-1);
+	for (m = current->mmap ; m < current->mmap+NR_MMAP ; m++) {
+		if (!m->inode || m->start >= end || m->end <= addr ||
+		    !(m->flags & MAP_SHARED))
+			continue;
+		sync_pages(m,(m->start > addr) ? m->start : addr,
+			(m->end < end) ? m->end : end);
+		inode = m->inode;
+		if ((flags & MS_SYNC) && inode->i_op->default_file_ops->fsync)
+			inode->i_op->default_file_ops->fsync(inode,NULL);
+	}
+	return 0;
+}
+
+/*
+ * exit() and exec() drop all the mappings before the page tables go.
+ */
+void exit_mmap(void)
+{
+	struct mmap_struct * m;
+
+	drop_shared_tables(get_base(current->ldt[2]),get_limit(0x17));
+	for (m = current->mmap ; m < current->mmap+NR_MMAP ; m++) {
+		if (!m->inode)
+			continue;
+		unmap_pages(m,m->start,m->end);
+		iput(m->inode);
+		m->inode = NULL;
+	}
+}
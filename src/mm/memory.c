@@ -29,8 +29,11 @@
  */
 
 #include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
 
 #include <asm/system.h>
+#include <asm/segment.h>
 
 #include <linux/sched.h>
 #include <linux/head.h>
@@ -48,28 +51,13 @@ unsigned long HIGH_MEMORY = 0;
 
 static unsigned long last_pages[CHECK_LAST_NR] = { 0, };
 
-unsigned char mem_map [ PAGING_PAGES ] = {0,};
-
-/*
- * Free a page of memory at physical address 'addr'. Used by
- * 'free_page_tables()'
- */
-void free_page(unsigned long addr)
-{
-	if (addr < LOW_MEM) return;
-	if (addr < HIGH_MEMORY) {
-		addr -= LOW_MEM;
-		addr >>= 12;
-		if (mem_map[addr]--)
-			return;
-		mem_map[addr]=0;
-	}
-	printk("trying to free free page: memory probably corrupted");
-}
+unsigned char * mem_map = NULL;
 
 /*
  * This function frees a continuos block of page tables, as needed
  * by 'exit()'. As does copy_page_tables(), this handles only 4Mb blocks.
+ * A table still shared after a fork() just loses one user: its pages
+ * belong to the other one(s) as well.
  */
 int free_page_tables(unsigned long from,unsigned long size)
 {
@@ -93,6 +81,11 @@ int free_page_tables(unsigned long from,unsigned long size)
 			continue;
 		}
 		pg_table = (unsigned long *) (0xfffff000 & page_dir);
+		if ((unsigned long) pg_table >= LOW_MEM &&
+		    mem_map[MAP_NR((unsigned long) pg_table)] > 1) {
+			free_page((unsigned long) pg_table);
+			continue;
+		}
 		for (nr=0 ; nr<1024 ; nr++,pg_table++) {
 			if (!(page = *pg_table))
 				continue;
@@ -110,6 +103,30 @@ int free_page_tables(unsigned long from,unsigned long size)
 	return 0;
 }
 
+/*
+ * exit() and exec() unmap the mmap()ed areas before freeing the page
+ * tables, to get dirty shared pages written back. A table that is still
+ * shared can simply be let go first: whoever else uses it has the same
+ * mappings, and does the writing.
+ */
+void drop_shared_tables(unsigned long from, unsigned long size)
+{
+	unsigned long * dir, table;
+
+	size = (size + 0x3fffff) >> 22;
+	dir = (unsigned long *) ((from>>20) & 0xffc);
+	for ( ; size-->0 ; dir++) {
+		if ((*dir & 3) != 1)
+			continue;
+		table = *dir & 0xfffff000;
+		if (table < LOW_MEM || mem_map[MAP_NR(table)] < 2)
+			continue;
+		*dir = 0;
+		free_page(table);
+	}
+	invalidate();
+}
+
 /*
  *  Well, here is one of the most complicated functions in mm. It
  * copies a range of linerar addresses by copying only the pages.
@@ -126,6 +143,11 @@ int free_page_tables(unsigned long from,unsigned long size)
  * doesn't take any more memory - we don't copy-on-write in the low
  * 1 Mb-range, so the pages can be shared with the kernel. Thus the
  * special case for nr=xxxx.
+ *
+ * Otherwise nothing is copied at all: the child gets the parent's page
+ * tables, write-protected in the page directory of both, and whoever
+ * changes one first gets a copy of it (see unshare_page_table()). A
+ * fork() followed by exec() never copies anything.
  */
 int copy_page_tables(unsigned long from,unsigned long to,long size)
 {
@@ -133,7 +155,6 @@ int copy_page_tables(unsigned long from,unsigned long to,long size)
 	unsigned long * to_page_table;
 	unsigned long this_page;
 	unsigned long * from_dir, * to_dir;
-	unsigned long new_page;
 	unsigned long nr;
 
 	if ((from&0x3fffff) || (to&0x3fffff))
@@ -154,6 +175,12 @@ int copy_page_tables(unsigned long from,unsigned long to,long size)
 			continue;
 		}
 		from_page_table = (unsigned long *) (0xfffff000 & *from_dir);
+		if (from) {
+			*from_dir &= ~2;
+			*to_dir = *from_dir;
+			mem_map[MAP_NR((unsigned long) from_page_table)]++;
+			continue;
+		}
 		if (!(to_page_table = (unsigned long *) get_free_page()))
 			return -1;	/* Out of memory, see freeing */
 		*to_dir = ((unsigned long) to_page_table) | 7;
@@ -163,12 +190,8 @@ int copy_page_tables(unsigned long from,unsigned long to,long size)
 			if (!this_page)
 				continue;
 			if (!(1 & this_page)) {
-				if (!(new_page = get_free_page()))
-					return -1;
-				++current->rss;
-				read_swap_page(this_page>>1, (char *) new_page);
+				swap_duplicate(this_page>>1);
 				*to_page_table = this_page;
-				*from_page_table = new_page | (PAGE_DIRTY | 7);
 				continue;
 			}
 			this_page &= ~2;
@@ -185,6 +208,58 @@ int copy_page_tables(unsigned long from,unsigned long to,long size)
 	return 0;
 }
 
+/*
+ * Gives the current process a page table of its own for 'address', if
+ * it still shares it with others since a fork(). The pages in the copy
+ * are shared from now on, so they are write-protected, and swapped-out
+ * pages get one more user of their swap slot: nothing is read in.
+ * Returns 0 if there is no memory for the copy.
+ */
+int unshare_page_table(unsigned long address)
+{
+	unsigned long * dir, * from, * to;
+	unsigned long old, table, page;
+	int nr;
+
+	dir = (unsigned long *) ((address>>20) & 0xffc);
+repeat:
+	if (((old = *dir) & 3) != 1)
+		return 1;
+	if ((old & 0xfffff000) < LOW_MEM ||
+	    mem_map[MAP_NR(old)] == 1) {
+		*dir |= 2;
+		invalidate();
+		return 1;
+	}
+	if (!(table = __get_free_page()))
+		return 0;
+/* we might have slept: see if it's still the same table, and shared */
+	if (*dir != old || mem_map[MAP_NR(old)] == 1) {
+		free_page(table);
+		goto repeat;
+	}
+	from = (unsigned long *) (old & 0xfffff000);
+	to = (unsigned long *) table;
+	for (nr = 0 ; nr < 1024 ; nr++,from++,to++) {
+		if (!(page = *from)) {
+			*to = 0;
+			continue;
+		}
+		if (!(page & 1)) {
+			swap_duplicate(page>>1);
+			*to = page;
+			continue;
+		}
+		*to = *from = page & ~2;
+		if (page >= LOW_MEM)
+			mem_map[MAP_NR(page)]++;
+	}
+	*dir = table | 7;
+	free_page(old & 0xfffff000);
+	invalidate();
+	return 1;
+}
+
 /*
  * This function puts a page in memory at the wanted address.
  * It returns the physical address of the page gotten, 0 if
@@ -261,6 +336,34 @@ unsigned long put_dirty_page(unsigned long page, unsigned long address)
 	return page;
 }
 
+/*
+ * And once more for pages from the page cache: they are shared, so they
+ * are mapped read-only unless 'rw' says otherwise.
+ */
+static unsigned long map_page(unsigned long page, unsigned long address,
+	int rw)
+{
+	unsigned long tmp, *page_table;
+
+	page_table = (unsigned long *) ((address>>20) & 0xffc);
+	if ((*page_table)&1)
+		page_table = (unsigned long *) (0xfffff000 & *page_table);
+	else {
+		if (!(tmp=get_free_page()))
+			return 0;
+		*page_table = tmp | 7;
+		page_table = (unsigned long *) tmp;
+	}
+	page_table += (address>>12) & 0x3ff;
+	if (*page_table) {
+		printk("map_page: page already exists\n");
+		*page_table = 0;
+		invalidate();
+	}
+	*page_table = page | (rw ? 7 : 5);
+	return page;
+}
+
 void un_wp_page(unsigned long * table_entry)
 {
 	unsigned long old_page;
@@ -290,13 +393,13 @@ repeat:
 		return;
 	}
 	if (!new_page) {
-		if (!(new_page=get_free_page()))
+		if (!(new_page=__get_free_page()))
 			oom();
 		goto repeat;
 	}
 	copy_page(old_page,new_page);
 	*table_entry = new_page | dirty | 7;
-//	free_page(old_page);
+	free_page(old_page);
 	invalidate();
 }	
 
@@ -309,6 +412,9 @@ repeat:
  */
 void do_wp_page(unsigned long error_code,unsigned long address)
 {
+	struct mmap_struct * m;
+	unsigned long * pte;
+
 	if (address < TASK_SIZE) {
 		printk("\n\rBAD! KERNEL MEMORY WP-ERR!\n\r");
 		do_exit(SIGSEGV);
@@ -318,9 +424,26 @@ void do_wp_page(unsigned long error_code,unsigned long address)
 		do_exit(SIGSEGV);
 	}
 	++current->min_flt;
-	un_wp_page((unsigned long *)
-		(((address>>10) & 0xffc) + (0xfffff000 &
-		*((unsigned long *) ((address>>20) &0xffc)))));
+	if (!unshare_page_table(address))
+		oom();
+	pte = (unsigned long *) (((address>>10) & 0xffc) + (0xfffff000 &
+		*((unsigned long *) ((address>>20) &0xffc))));
+/* it might have been just the table that was write-protected */
+	if (*pte & PAGE_RW) {
+		invalidate();
+		return;
+	}
+/* a shared mapping is written in place: that's what it's for */
+	if (m = find_mmap(current,address - current->start_code)) {
+		if (!(m->prot & PROT_WRITE))
+			do_exit(SIGSEGV);
+		if (m->flags & MAP_SHARED) {
+			*pte |= PAGE_DIRTY | PAGE_RW;
+			invalidate();
+			return;
+		}
+	}
+	un_wp_page(pte);
 }
 
 void write_verify(unsigned long address)
@@ -329,6 +452,11 @@ void write_verify(unsigned long address)
 
 	if (!( (page = *((unsigned long *) ((address>>20) & 0xffc)) )&1))
 		return;
+	if (!(page & 2)) {
+		if (!unshare_page_table(address))
+			oom();
+		page = *((unsigned long *) ((address>>20) & 0xffc));
+	}
 	page &= 0xfffff000;
 	page += ((address>>10) & 0xffc);
 	if ((3 & *(unsigned long *) page) == 1)  /* non-writeable, present */
@@ -336,110 +464,56 @@ void write_verify(unsigned long address)
 	return;
 }
 
-void get_empty_page(unsigned long address)
-{
-	unsigned long tmp;
-
-	if (!(tmp=get_free_page()) || !put_page(tmp,address)) {
-		free_page(tmp);		/* 0 is ok - ignored */
-		oom();
-	}
-}
-
 /*
- * try_to_share() checks the page at address "address" in the task "p",
- * to see if it exists, and if it is clean. If so, share it with the current
- * task.
- *
- * NOTE! This assumes we have checked that p != current, and that they
- * share the same executable or library.
+ * pin_page() is for direct I/O: it returns the physical address of the
+ * user page 'addr' is in, made present (and private and writable if the
+ * I/O is going to write into it). The page is pinned by bumping its
+ * mem_map[] count, which keeps swap_out() away from it: free_page()
+ * unpins it again.
  */
-static int try_to_share(unsigned long address, struct task_struct * p)
+unsigned long pin_page(char * addr, int write)
 {
-	unsigned long from;
-	unsigned long to;
-	unsigned long from_page;
-	unsigned long to_page;
-	unsigned long phys_addr;
-
-	from_page = to_page = ((address>>20) & 0xffc);
-	from_page += ((p->start_code>>20) & 0xffc);
-	to_page += ((current->start_code>>20) & 0xffc);
-/* is there a page-directory at from? */
-	from = *(unsigned long *) from_page;
-	if (!(from & 1))
-		return 0;
-	from &= 0xfffff000;
-	from_page = from + ((address>>10) & 0xffc);
-	phys_addr = *(unsigned long *) from_page;
-/* is the page clean and present? */
-	if ((phys_addr & 0x41) != 0x01)
-		return 0;
-	phys_addr &= 0xfffff000;
-	if (phys_addr >= HIGH_MEMORY || phys_addr < LOW_MEM)
+	unsigned long address, page, * table;
+
+repeat:
+	get_fs_byte(addr);
+	address = (unsigned long) addr + get_base(current->ldt[2]);
+	if (write)
+		write_verify(address);
+	page = *((unsigned long *) ((address>>20) & 0xffc));
+	if (!(page & 1))
+		goto repeat;
+	table = (unsigned long *) ((page & 0xfffff000) + ((address>>10) & 0xffc));
+	if (!(*table & 1) || (write && !(*table & 2)))
+		goto repeat;
+	page = *table & 0xfffff000;
+	if (page < LOW_MEM || page >= HIGH_MEMORY)
 		return 0;
-	to = *(unsigned long *) to_page;
-	if (!(to & 1)) {
-		if (to = get_free_page())
-			*(unsigned long *) to_page = to | 7;
-		else
-			oom();
-	}
-	to &= 0xfffff000;
-	to_page = to + ((address>>10) & 0xffc);
-	if (1 & *(unsigned long *) to_page)
-		panic("try_to_share: to_page already exists");
-/* share them: write-protect */
-	*(unsigned long *) from_page &= ~2;
-	*(unsigned long *) to_page = *(unsigned long *) from_page;
-	invalidate();
-	phys_addr -= LOW_MEM;
-	phys_addr >>= 12;
-	mem_map[phys_addr]++;
-	return 1;
+	mem_map[MAP_NR(page)]++;
+	if (write)
+		*table |= PAGE_DIRTY;
+	return page;
 }
 
-/*
- * share_page() tries to find a process that could share a page with
- * the current one. Address is the address of the wanted page relative
- * to the current data space.
- *
- * We first check if it is at all feasible by checking executable->i_count.
- * It should be >1 if there are other tasks sharing this inode.
- */
-static int share_page(struct m_inode * inode, unsigned long address)
+void get_empty_page(unsigned long address)
 {
-	struct task_struct ** p;
+	unsigned long tmp;
 
-	if (inode->i_count < 2 || !inode)
-		return 0;
-	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p) {
-		if (!*p)
-			continue;
-		if (current == *p)
-			continue;
-		if (address < LIBRARY_OFFSET) {
-			if (inode != (*p)->executable)
-				continue;
-		} else {
-			if (inode != (*p)->library)
-				continue;
-		}
-		if (try_to_share(address,*p))
-			return 1;
+	if (!(tmp=get_free_page()) || !put_page(tmp,address)) {
+		free_page(tmp);		/* 0 is ok - ignored */
+		oom();
 	}
-	return 0;
 }
 
 void do_no_page(unsigned long error_code, unsigned long address,
 	struct task_struct *tsk)
 {
 	static unsigned int last_checked = 0;
-	int nr[4];
-	unsigned long tmp;
-	unsigned long page;
-	int block,i;
+	unsigned long tmp, offset;
+	unsigned long page, new_page;
+	int i;
 	struct m_inode * inode;
+	struct mmap_struct * m;
 
 	/* Thrashing ? Make it interruptible, but don't penalize otherwise */
 	for (i = 0; i < CHECK_LAST_NR; i++)
@@ -460,6 +534,8 @@ void do_no_page(unsigned long error_code, unsigned long address,
 		do_exit(SIGSEGV);
 	}
 	++tsk->rss;
+	if (!unshare_page_table(address))
+		oom();
 	page = *(unsigned long *) ((address >> 20) & 0xffc);
 /* check the page directory: make a page dir entry if no such exists */
 	if (page & 1) {
@@ -481,15 +557,28 @@ void do_no_page(unsigned long error_code, unsigned long address,
 	}
 	address &= 0xfffff000;
 	tmp = address - tsk->start_code;
+	if (m = find_mmap(tsk,tmp)) {
+		if ((error_code & 2) && !(m->prot & PROT_WRITE))
+			do_exit(SIGSEGV);
+		++tsk->maj_flt;
+		if (!(page = get_cache_page(m->inode,m->offset + tmp - m->start)))
+			oom();
+		if (map_page(page,address,(m->flags & MAP_SHARED) &&
+		    (m->prot & PROT_WRITE)))
+			return;
+		free_page(page);
+		oom();
+	}
+/* remember that 1 block is used for header */
 	if (tmp >= LIBRARY_OFFSET ) {
 		inode = tsk->library;
-		block = 1 + (tmp-LIBRARY_OFFSET) / BLOCK_SIZE;
+		offset = BLOCK_SIZE + tmp - LIBRARY_OFFSET;
 	} else if (tmp < tsk->end_data) {
 		inode = tsk->executable;
-		block = 1 + tmp / BLOCK_SIZE;
+		offset = BLOCK_SIZE + tmp;
 	} else {
 		inode = NULL;
-		block = 0;
+		offset = 0;
 	}
 	if (!inode) {
 		++tsk->min_flt;
@@ -499,43 +588,57 @@ void do_no_page(unsigned long error_code, unsigned long address,
 		get_empty_page(address);
 		return;
 	}
-	if (tsk == current)
-		if (share_page(inode,tmp)) {
-			++tsk->min_flt;
-			return;
-		}
 	++tsk->maj_flt;
-	if (!(page = get_free_page()))
+	if (!(page = get_cache_page(inode,offset)))
 		oom();
-/* remember that 1 block is used for header */
-	for (i=0 ; i<4 ; block++,i++)
-		nr[i] = bmap(inode,block);
-	bread_page(page,inode->i_dev,nr);
+/* the page the data ends in is partly bss: that one is private */
 	i = tmp + 4096 - tsk->end_data;
-	if (i>4095)
-		i = 0;
-	tmp = page + 4096;
-	while (i-- > 0) {
-		tmp--;
-		*(char *)tmp = 0;
-	}
-	if (put_page(page,address))
+	if (i > 0 && i < 4096) {
+		if (!(new_page = get_free_page())) {
+			free_page(page);
+			oom();
+		}
+		memcpy((char *) new_page,(char *) page,4096-i);
+		free_page(page);
+		if (put_page(new_page,address))
+			return;
+		page = new_page;
+	} else if (map_page(page,address,0))
 		return;
 	free_page(page);
 	oom();
 }
 
+/*
+ * head.s maps the first 16Mb. The page tables for anything above that,
+ * mem_map[], the allocator's own map, the swap cache and the page cache
+ * index come off the start of main memory, which is always below 16Mb.
+ */
 void mem_init(long start_mem, long end_mem)
 {
+	unsigned long * pg_table, addr;
 	int i;
 
-	swap_device = 0;
-	swap_file = NULL;
 	HIGH_MEMORY = end_mem;
+	for (addr = 16*1024*1024 ; addr < end_mem ; addr += 4*1024*1024) {
+		pg_table = (unsigned long *) start_mem;
+		start_mem += PAGE_SIZE;
+		for (i=0 ; i<1024 ; i++)
+			pg_table[i] = (addr + (i<<12) < end_mem) ?
+				(addr + (i<<12)) | 7 : 0;
+		pg_dir[addr>>22] = (unsigned long) pg_table | 7;
+	}
+	invalidate();
+	mem_map = (unsigned char *) start_mem;
+	start_mem = free_area_init(start_mem + PAGING_PAGES);
+	start_mem = swap_cache_init(start_mem);
+	start_mem = page_cache_init(start_mem);
+	start_mem = (start_mem + 4095) & 0xfffff000;
 	for (i=0 ; i<PAGING_PAGES ; i++)
 		mem_map[i] = USED;
 	for (i=MAP_NR(start_mem); i<MAP_NR(end_mem); ++i) {
-		mem_map[i] = 0;
+		mem_map[i] = 1;
+		free_page(LOW_MEM + (i<<12));
 	}
 }
 
@@ -566,7 +669,7 @@ void show_mem(void)
 	printk("%d free pages of %d\n\r",free,total);
 	printk("%d pages shared\n\r",shared);
 	k = 0;
-	for(i=4 ; i<1024 ;) {
+	for(i=TASK_SIZE>>22 ; i<1024 ;) {
 		if (1&pg_dir[i]) {
 			if (pg_dir[i]>HIGH_MEMORY) {
 				printk("page directory[%d]: %08X\n\r",
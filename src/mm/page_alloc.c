@@ -0,0 +1,264 @@
+/*
+ *  linux/mm/page_alloc.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * Free memory is kept in buddy lists: a free block of 2^order pages is
+ * on free_area[order], and starts at a multiple of 2^order pages from
+ * LOW_MEM. The list links live in the free pages themselves, and
+ * free_order[] tells which page heads a free block (and of what order),
+ * so a freed block finds its buddy and merges without any searching.
+ *
+ * mem_map[] still counts the users of every page: a page goes back on
+ * the lists when its count drops to zero, so free_page() works for any
+ * page of a bigger block too.
+ *
+ * get_free_page() hands out cleared pages, and clearing 4kB in the page
+ * fault path isn't free. So the idle task keeps a few pages cleared in
+ * advance, and callers that overwrite the whole page anyway use
+ * __get_free_page(), which doesn't clear anything.
+ *
+ * Reclaiming is mostly done by kswapd, a process of its own: it is woken
+ * when the free pages drop below free_pages_low, and swaps until there
+ * are free_pages_high again. Allocation only has to reclaim by itself
+ * if kswapd can't keep up.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/system.h>
+
+struct free_block {
+	struct free_block * next, * prev;
+};
+
+static struct free_block * free_area[NR_ORDERS] = { NULL, };
+static unsigned char * free_order;		/* order+1 for each page */
+
+int nr_free_pages = 0;
+
+#define NR_ZERO_PAGES	32
+
+static unsigned long zero_pages[NR_ZERO_PAGES];
+static int nr_zero_pages = 0;
+
+static int free_pages_low, free_pages_high;
+static struct task_struct * kswapd_wait = NULL;
+static int kswapd_running = 0;
+
+#define block_addr(nr) ((struct free_block *) (LOW_MEM + ((nr)<<12)))
+
+static inline void link_block(unsigned long nr, int order)
+{
+	struct free_block * p = block_addr(nr);
+
+	p->prev = NULL;
+	if (p->next = free_area[order])
+		p->next->prev = p;
+	free_area[order] = p;
+	free_order[nr] = order+1;
+}
+
+static inline void unlink_block(struct free_block * p, int order)
+{
+	if (p->prev)
+		p->prev->next = p->next;
+	else
+		free_area[order] = p->next;
+	if (p->next)
+		p->next->prev = p->prev;
+	free_order[MAP_NR((unsigned long) p)] = 0;
+}
+
+/*
+ * Free a page of memory at physical address 'addr'. Used by
+ * 'free_page_tables()'
+ */
+void free_page(unsigned long addr)
+{
+	unsigned long nr, buddy;
+	int order = 0;
+
+	if (addr < LOW_MEM) return;
+	if (addr >= HIGH_MEMORY || !mem_map[nr = MAP_NR(addr)]) {
+		printk("trying to free free page: memory probably corrupted");
+		return;
+	}
+	if (--mem_map[nr])
+		return;
+	if (swap_cache[nr]) {
+		swap_free(swap_cache[nr]);
+		swap_cache[nr] = 0;
+	}
+	cli();
+	nr_free_pages++;
+	for ( ; order < NR_ORDERS-1 ; order++) {
+		buddy = nr ^ (1<<order);
+		if (buddy >= PAGING_PAGES || free_order[buddy] != order+1)
+			break;
+		unlink_block(block_addr(buddy),order);
+		nr &= ~(1<<order);
+	}
+	link_block(nr,order);
+	sti();
+}
+
+void free_pages(unsigned long addr, int order)
+{
+	int i;
+
+	for (i = 0 ; i < (1<<order) ; i++, addr += PAGE_SIZE)
+		free_page(addr);
+}
+
+/*
+ * Get 2^order physically contiguous pages, and mark them used. They are
+ * not cleared. Returns 0 if there is no such block.
+ */
+unsigned long get_free_pages(int order)
+{
+	struct free_block * p;
+	unsigned long nr;
+	int i;
+
+	if (order < 0 || order >= NR_ORDERS)
+		return 0;
+	cli();
+	for (i = order ; i < NR_ORDERS ; i++)
+		if (free_area[i])
+			break;
+	if (i >= NR_ORDERS) {
+		sti();
+		return 0;
+	}
+	unlink_block(p = free_area[i],i);
+	nr = MAP_NR((unsigned long) p);
+/* give back the halves we don't need */
+	while (i > order) {
+		i--;
+		link_block(nr + (1<<i),i);
+	}
+	for (i = 0 ; i < (1<<order) ; i++)
+		mem_map[nr+i] = 1;
+	nr_free_pages -= 1<<order;
+	sti();
+	if (nr_free_pages < free_pages_low)
+		wake_up(&kswapd_wait);
+	return (unsigned long) p;
+}
+
+/*
+ * free_order[] is as big as mem_map[]: it's taken from the start of main
+ * memory by mem_init(), which then frees the rest into the lists.
+ */
+unsigned long free_area_init(unsigned long start_mem)
+{
+	free_order = (unsigned char *) start_mem;
+	memset(free_order,0,PAGING_PAGES);
+	if ((free_pages_low = PAGING_PAGES >> 6) < 8)
+		free_pages_low = 8;
+	free_pages_high = 2*free_pages_low;
+	return start_mem + PAGING_PAGES;
+}
+
+static unsigned long get_zero_page(void)
+{
+	unsigned long page = 0;
+
+	cli();
+	if (nr_zero_pages)
+		page = zero_pages[--nr_zero_pages];
+	sti();
+	return page;
+}
+
+/*
+ * Get physical address of a free page, and mark it used. The contents
+ * are whatever was there. If there are no free pages, the cleared ones
+ * go first, then the page cache and swapping have to make one. Returns
+ * 0 if even that doesn't help.
+ */
+unsigned long __get_free_page(void)
+{
+	unsigned long page;
+
+	while (!(page = get_free_pages(0)))
+		if (page = get_zero_page())
+			break;
+		else if (!shrink_page_cache() && !swap_out()) {
+			printk("Out of swap-memory\n\r");
+			return 0;
+		}
+	return page;
+}
+
+/*
+ * Same, but the page is cleared.
+ */
+unsigned long get_free_page(void)
+{
+	unsigned long page;
+
+	if (page = get_zero_page())
+		return page;
+	if (page = __get_free_page())
+		memset((void *) page,0,PAGE_SIZE);
+	return page;
+}
+
+/*
+ * Called by task 0 when there is nothing else to do: clears one more
+ * page for get_free_page(). The pool never takes the pages kswapd is
+ * supposed to keep free.
+ */
+void fill_zero_pages(void)
+{
+	unsigned long page;
+
+	if (nr_zero_pages >= NR_ZERO_PAGES || nr_free_pages <= free_pages_high)
+		return;
+	if (!(page = get_free_pages(0)))
+		return;
+	memset((void *) page,0,PAGE_SIZE);
+	cli();
+	if (nr_zero_pages < NR_ZERO_PAGES) {
+		zero_pages[nr_zero_pages++] = page;
+		page = 0;
+	}
+	sti();
+	if (page)
+		free_page(page);
+}
+
+/*
+ * kswapd: started by init through kdaemon(), never returns. If there is
+ * nothing left to take, it waits a bit instead of spinning. It never
+ * gets back to user mode to take a signal, so it throws them away: a
+ * pending one would end every wait at once.
+ */
+int swap_daemon(void)
+{
+	if (kswapd_running)
+		return -EBUSY;
+	kswapd_running = 1;
+	for (;;) {
+		cli();
+		while (nr_free_pages >= free_pages_low)
+			sleep_on(&kswapd_wait);
+		sti();
+		while (nr_free_pages < free_pages_high)
+			if (!shrink_page_cache() && !swap_out()) {
+				current->signal = 0;
+				current->timeout = jiffies + HZ/4;
+				interruptible_sleep_on(&kswapd_wait);
+				current->timeout = 0;
+				break;
+			}
+	}
+}
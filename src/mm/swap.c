@@ -9,134 +9,396 @@
  * Started 18.12.91
  */
 
+/*
+ * There can be MAX_SWAPFILES swap areas, devices or files, added and
+ * removed with swapon()/swapoff(). A swap entry is the area ('type') and
+ * the page in it ('offset'), see SWP_ENTRY(). The areas are kept sorted
+ * by priority: slots come from the highest priority area that has any,
+ * and areas of equal priority take turns, so that swapping is spread
+ * over them.
+ *
+ * Each area has a count of users for every slot, kept in pages of their
+ * own: a page of pointers to them is all that has to be contiguous, so
+ * big areas are no problem.
+ */
+
 #include <string.h>
 #include <errno.h>
+#include <sys/swap.h>
 
 #include <linux/mm.h>
 #include <sys/stat.h>
 #include <linux/sched.h>
 #include <linux/head.h>
 #include <linux/kernel.h>
+#include <asm/system.h>
 
-#define SWAP_BITS (4096<<3)
+#define SWP_USED	1
+#define SWP_WRITEOK	3
 
-#define bitop(name,op) \
-static inline int name(char * addr,unsigned int nr) \
-{ \
-	int __res; \
-	__asm__ __volatile__("bt" op " %1,%2; adcl $0,%0" \
-		:"=g" (__res) \
-		:"r" (nr),"m" (*(addr)),"0" (0)); \
-	return __res; \
-}
+#define SWAP_MAP_MAX	0xfe
+#define SWAP_MAP_BAD	0xff
+
+#define MAX_SWAP_PAGES	(1024*4096)	/* a page of pointers to maps */
 
-bitop(bit,"")
-bitop(setbit,"s")
-bitop(clrbit,"r")
+static struct swap_info_struct {
+	unsigned int flags;
+	int dev;			/* 0 for a swap file */
+	struct m_inode * file;
+	unsigned char ** swap_map;
+	int max;			/* slots are 1..max-1 */
+	int inuse;
+	int prio;
+	int next;			/* next area in priority order */
+	int cluster_next, cluster_left;
+} swap_info[MAX_SWAPFILES];
+
+static int swap_head = -1, swap_next = -1;
+static int least_priority = 0;
 
-static char * swap_bitmap = NULL;
-unsigned int swap_device = 0;
-struct m_inode * swap_file = NULL;
 int SWAP_DEV = 0;
-void rw_swap_page(int rw, unsigned int nr, char * buf)
+
+#define swap_count(p,off) ((p)->swap_map[(off)>>12][(off) & 0xfff])
+
+static struct swap_info_struct * get_swap_info(unsigned long entry)
+{
+	struct swap_info_struct * p;
+
+	if (SWP_TYPE(entry) >= MAX_SWAPFILES)
+		return NULL;
+	p = swap_info + SWP_TYPE(entry);
+	if (!(p->flags & SWP_USED) || !SWP_OFFSET(entry) ||
+	    SWP_OFFSET(entry) >= p->max)
+		return NULL;
+	return p;
+}
+
+void rw_swap_page(int rw, unsigned long entry, char * buf)
 {
+	struct swap_info_struct * p;
 	unsigned int zones[4];
-	int i;
+	int i, nr;
 
-	if (swap_device) {
-		ll_rw_page(rw,swap_device,nr,buf);
+	if (SWP_TYPE(entry) >= MAX_SWAPFILES ||
+	    !((p = swap_info + SWP_TYPE(entry))->flags & SWP_USED)) {
+		printk("rw_swap_page: bad swap entry %08x\n\r",entry);
 		return;
 	}
-	if (swap_file) {
-		nr <<= 2;
-		for (i = 0; i < 4; i++)
-			if (!(zones[i] = bmap(swap_file,nr++))) {
-				printk("rw_swap_page: bad swap file\n");
-				return;
-			}
-		ll_rw_swap_file(rw,swap_file->i_dev, zones,4,buf);
+	if (p->dev) {
+		ll_rw_page(rw,p->dev,SWP_OFFSET(entry),buf);
 		return;
 	}
-	printk("ll_swap_page: no swap file or device\n");
+	nr = SWP_OFFSET(entry) << 2;
+	for (i = 0; i < 4; i++)
+		if (!(zones[i] = p->file->i_op->bmap(p->file,nr++))) {
+			printk("rw_swap_page: bad swap file\n\r");
+			return;
+		}
+	ll_rw_swap_file(rw,p->file->i_dev,zones,4,buf);
 }
 
 /*
- * We never page the pages in task[0] - kernel memory.
- * We page all other pages.
+ * Slots are handed out in clusters of CLUSTER_SLOTS: the pages swap_out()
+ * takes one after another usually belong together, and this way they
+ * end up next to each other on disk, where swap_in() can read them all
+ * at once. Only if there is no free cluster left does any slot do.
  */
-#define FIRST_VM_PAGE (TASK_SIZE>>12)
-#define LAST_VM_PAGE (1024*1024)
-#define VM_PAGES (LAST_VM_PAGE - FIRST_VM_PAGE)
+#define CLUSTER_SLOTS	16
 
-static int get_swap_page(void)
+static int scan_swap_map(struct swap_info_struct * p)
 {
-	int nr;
+	int nr, n, i;
 
-	if (!swap_bitmap)
-		return 0;
-	for (nr = 1; nr < SWAP_BITS ; nr++)
-		if (clrbit(swap_bitmap,nr))
-			return nr;
+	if (p->cluster_left && p->cluster_next < p->max &&
+	    !swap_count(p,p->cluster_next)) {
+		p->cluster_left--;
+		nr = p->cluster_next++;
+		goto got;
+	}
+	for (i = n = 0, nr = p->cluster_next ; i < p->max ; i++, nr++) {
+		if (nr >= p->max)
+			nr = 1, n = 0;
+		if (swap_count(p,nr)) {
+			n = 0;
+			continue;
+		}
+		if (++n < CLUSTER_SLOTS)
+			continue;
+		nr -= CLUSTER_SLOTS-1;
+		p->cluster_next = nr+1;
+		p->cluster_left = CLUSTER_SLOTS-1;
+		goto got;
+	}
+	p->cluster_left = 0;
+	for (nr = 1 ; nr < p->max ; nr++)
+		if (!swap_count(p,nr))
+			goto got;
 	return 0;
+got:
+	swap_count(p,nr) = 1;
+	p->inuse++;
+	return nr;
+}
+
+static unsigned long get_swap_page(void)
+{
+	struct swap_info_struct * p;
+	int type, wrapped = 0, offset;
+
+	if ((type = swap_next) < 0)
+		return 0;
+	for (;;) {
+		p = swap_info + type;
+		if ((p->flags & SWP_WRITEOK) == SWP_WRITEOK &&
+		    (offset = scan_swap_map(p))) {
+			if (p->next >= 0 && swap_info[p->next].prio == p->prio)
+				swap_next = p->next;
+			else
+				swap_next = swap_head;
+			return SWP_ENTRY(type,offset);
+		}
+		type = p->next;
+		if (!wrapped) {
+			if (type < 0 || swap_info[type].prio != p->prio) {
+				type = swap_head;
+				wrapped = 1;
+			}
+		} else if (type < 0)
+			return 0;
+	}
+}
+
+/*
+ * The swap cache: a page swapped in keeps its slot, and swap_cache[]
+ * remembers which one. As long as the page isn't written to, swapping
+ * it out again needs no I/O: the slot still has it. The page holds a
+ * reference to the slot until it's freed or swapped out.
+ *
+ * swap_in() also reads the next few slots in use, which clustering has
+ * probably given to the same process. Those pages wait in ahead[] for
+ * a swap_in() of their own. A slot that is freed or written again loses
+ * its ahead[] copy, and reads that might have raced with a write are
+ * thrown away.
+ */
+#define NR_AHEAD	16
+#define READ_AHEAD	4
+
+unsigned long * swap_cache = NULL;
+
+static unsigned long ahead[NR_AHEAD] = { 0, };
+static unsigned long ahead_entry[NR_AHEAD];
+static int ahead_hand = 0;
+static int swap_writes = 0, swap_writing = 0;
+
+extern int max_sectors[];
+
+unsigned long swap_cache_init(unsigned long start_mem)
+{
+	swap_cache = (unsigned long *) start_mem;
+	memset(swap_cache,0,PAGING_PAGES*sizeof (long));
+	return start_mem + PAGING_PAGES*sizeof (long);
+}
+
+static void drop_ahead(int i)
+{
+	unsigned long page = ahead[i];
+
+	ahead[i] = 0;
+	free_page(page);
+}
+
+static int find_ahead(unsigned long entry)
+{
+	int i;
+
+	for (i = 0 ; i < NR_AHEAD ; i++)
+		if (ahead[i] && ahead_entry[i] == entry)
+			return i;
+	return -1;
+}
+
+static void forget_ahead(unsigned long entry)
+{
+	int i;
+
+	if ((i = find_ahead(entry)) >= 0)
+		drop_ahead(i);
+}
+
+static void add_ahead(unsigned long entry, unsigned long page)
+{
+	if (ahead[ahead_hand])
+		drop_ahead(ahead_hand);
+	ahead[ahead_hand] = page;
+	ahead_entry[ahead_hand] = entry;
+	ahead_hand = (ahead_hand+1) % NR_AHEAD;
+}
+
+static void read_ahead(unsigned long entry)
+{
+	struct swap_info_struct * p = get_swap_info(entry);
+	struct buffer_head bh[READ_AHEAD];
+	int i, n, off, writes = swap_writes;
+	unsigned long page;
+
+	if (!p || !p->dev || swap_writing || max_sectors[MAJOR(p->dev)] < 8)
+		return;
+	off = SWP_OFFSET(entry) + 1;
+	entry++;
+	for (n = 0 ; n < READ_AHEAD ; n++) {
+		if (off+n >= p->max || !swap_count(p,off+n) ||
+		    swap_count(p,off+n) == SWAP_MAP_BAD ||
+		    find_ahead(entry+n) >= 0)
+			break;
+		if (!(page = get_free_pages(0)))
+			break;
+		bh[n].b_dev = p->dev;
+		bh[n].b_blocknr = (off+n)<<2;
+		bh[n].b_data = (char *) page;
+		bh[n].b_count = 1;
+		bh[n].b_lock = 0;
+		bh[n].b_uptodate = 0;
+		bh[n].b_wait = NULL;
+		ll_rw_direct(READ,bh+n,8);
+	}
+	for (i = 0 ; i < n ; i++) {
+		cli();
+		while (bh[i].b_lock)
+			sleep_on(&bh[i].b_wait);
+		sti();
+		page = (unsigned long) bh[i].b_data;
+		if (!bh[i].b_uptodate || writes != swap_writes ||
+		    !(p->flags & SWP_USED) || !swap_count(p,off+i) ||
+		    find_ahead(entry+i) >= 0)
+			free_page(page);
+		else
+			add_ahead(entry+i,page);
+	}
 }
 
-void swap_free(int swap_nr)
+void swap_free(unsigned long entry)
 {
-	if (!swap_nr)
+	struct swap_info_struct * p;
+
+	if (!entry)
+		return;
+	if (!(p = get_swap_info(entry))) {
+		printk("swap_free: bad swap entry %08x\n\r",entry);
 		return;
-	if (swap_bitmap && swap_nr < SWAP_BITS)
-		if (!setbit(swap_bitmap,swap_nr))
+	}
+	switch (swap_count(p,SWP_OFFSET(entry))) {
+		case 0:
+		case SWAP_MAP_BAD:
+			printk("swap_free: swap-space map bad (entry %08x)\n\r",
+				entry);
 			return;
-	printk("swap_free: swap-space bitmap bad\n");
-	return;
+		case SWAP_MAP_MAX:	/* stuck: we don't know any more */
+			return;
+	}
+	if (--swap_count(p,SWP_OFFSET(entry)))
+		return;
+	p->inuse--;
+	forget_ahead(entry);
 }
 
-void swap_in(unsigned long *table_ptr)
+/*
+ * One more page table entry refers to 'entry' (fork() shares them).
+ */
+void swap_duplicate(unsigned long entry)
 {
-	int swap_nr;
-	unsigned long page;
+	struct swap_info_struct * p;
 
-	if (!swap_bitmap) {
-		printk("Trying to swap in without swap bit-map");
+	if (!entry)
+		return;
+	if (!(p = get_swap_info(entry))) {
+		printk("swap_duplicate: bad swap entry %08x\n\r",entry);
 		return;
 	}
+	switch (swap_count(p,SWP_OFFSET(entry))) {
+		case 0:
+		case SWAP_MAP_BAD:
+			printk("swap_duplicate: swap-space map bad (entry %08x)\n\r",
+				entry);
+			return;
+		case SWAP_MAP_MAX:
+			return;
+	}
+	swap_count(p,SWP_OFFSET(entry))++;
+}
+
+void swap_in(unsigned long *table_ptr)
+{
+	unsigned long entry, page;
+	int i;
+
 	if (1 & *table_ptr) {
 		printk("trying to swap in present page\n\r");
 		return;
 	}
-	swap_nr = *table_ptr >> 1;
-	if (!swap_nr) {
+	entry = *table_ptr >> 1;
+	if (!get_swap_info(entry)) {
 		printk("No swap page in swap_in\n\r");
 		return;
 	}
-	if (!(page = get_free_page()))
-		oom();
-	read_swap_page(swap_nr, (char *) page);
-	if (setbit(swap_bitmap,swap_nr))
-		printk("swapping in multiply from same page\n\r");
-	*table_ptr = page | (PAGE_DIRTY | 7);
+	if ((i = find_ahead(entry)) >= 0) {
+		page = ahead[i];
+		ahead[i] = 0;
+	} else {
+		if (!(page = __get_free_page()))
+			oom();
+		read_swap_page(entry, (char *) page);
+		read_ahead(entry);
+	}
+	swap_cache[MAP_NR(page)] = entry;
+	*table_ptr = page | 7;
 }
 
-int try_to_swap_out(unsigned long * table_ptr)
+/*
+ * Gets rid of the page at 'table_ptr'. A clean page is simply dropped:
+ * it can be read back from the file (or is all zeroes), or it is still
+ * in its swap slot. A dirty one has to go to swap - its old slot if
+ * nobody else is using that.
+ */
+static int try_to_swap_out(unsigned long * table_ptr)
 {
-	unsigned long page;
-	unsigned long swap_nr;
+	struct swap_info_struct * p;
+	unsigned long page, nr;
+	unsigned long entry;
+	int write;
 
 	page = *table_ptr;
 	if (!(PAGE_PRESENT & page))
 		return 0;
 	if (page - LOW_MEM > PAGING_MEMORY)
 		return 0;
-	if (PAGE_DIRTY & page) {
-		page &= 0xfffff000;
-		if (mem_map[MAP_NR(page)] != 1)
+	nr = MAP_NR(page & 0xfffff000);
+	if ((write = PAGE_DIRTY & page) || swap_cache[nr]) {
+		if (mem_map[nr] != 1)
 			return 0;
-		if (!(swap_nr = get_swap_page()))
+		if (entry = swap_cache[nr]) {
+			swap_cache[nr] = 0;
+			p = get_swap_info(entry);
+			if ((p->flags & SWP_WRITEOK) != SWP_WRITEOK ||
+			    write && swap_count(p,SWP_OFFSET(entry)) != 1) {
+				swap_free(entry);
+				entry = 0;
+				write = 1;
+			}
+		}
+		if (!entry && !(entry = get_swap_page())) {
+			*table_ptr |= PAGE_DIRTY;	/* it's the only copy now */
 			return 0;
-		*table_ptr = swap_nr<<1;
+		}
+		*table_ptr = entry<<1;
 		invalidate();
-		write_swap_page(swap_nr, (char *) page);
-		free_page(page);
+		if (write) {
+			forget_ahead(entry);
+			swap_writes++;
+			swap_writing++;
+			write_swap_page(entry, (char *) (page & 0xfffff000));
+			swap_writing--;
+		}
+		free_page(page & 0xfffff000);
 		return 1;
 	}
 	*table_ptr = 0;
@@ -146,130 +408,389 @@ int try_to_swap_out(unsigned long * table_ptr)
 }
 
 /*
- * Go through the page tables, searching for a user page that
- * we can swap out.
+ * swap_out() is a clock. The hand goes round the tasks, and within each
+ * task round its pages from where it stopped the last time. A page that
+ * has been used since then (PAGE_ACCESSED) has the bit cleared and gets
+ * another chance. Each task has at most SWAP_CLUSTER pages looked at per
+ * turn, so the hand moves on even if the task is big.
+ *
+ * The first time round only clean pages are taken: they cost nothing to
+ * drop. Only if there are none does a dirty page get written to swap.
+ * We never page the pages in task[0] - kernel memory.
  */
-int swap_out(void)
+#define SWAP_CLUSTER	32
+
+static unsigned long swap_address[NR_TASKS] = { 0, };
+static int swap_task = 1;
+
+static int swap_task_out(int nr, int dirty)
 {
-	static int dir_entry = FIRST_VM_PAGE>>10;
-	static int page_entry = -1;
-	int counter = VM_PAGES;
-	int pg_table;
-
-	while (counter>0) {
-		pg_table = pg_dir[dir_entry];
-		if (pg_table & 1)
-			break;
-		counter -= 1024;
-		dir_entry++;
-		if (dir_entry >= 1024)
-			dir_entry = FIRST_VM_PAGE>>10;
-	}
-	pg_table &= 0xfffff000;
-	while (counter-- > 0) {
-		page_entry++;
-		if (page_entry >= 1024) {
-			page_entry = 0;
-		repeat:
-			dir_entry++;
-			if (dir_entry >= 1024)
-				dir_entry = FIRST_VM_PAGE>>10;
-			pg_table = pg_dir[dir_entry];
-			if (!(pg_table&1))
-				if ((counter -= 1024) > 0)
-					goto repeat;
-				else
-					break;
-			pg_table &= 0xfffff000;
+	unsigned long addr = swap_address[nr];
+	unsigned long pg_table, * page, * victim = NULL;
+	int count = SWAP_CLUSTER;
+
+	while (count > 0 && addr < TASK_SIZE) {
+		pg_table = pg_dir[(nr*TASK_SIZE + addr) >> 22];
+		if (!(pg_table & 1)) {
+			addr = (addr + 0x400000) & 0xffc00000;
+			continue;
 		}
-		if (try_to_swap_out(page_entry + (unsigned long *) pg_table))
+		page = (unsigned long *) (pg_table & 0xfffff000);
+		page += (addr >> 12) & 0x3ff;
+		addr += PAGE_SIZE;
+		if (!(*page & PAGE_PRESENT))
+			continue;
+		count--;
+		if (*page & PAGE_ACCESSED) {
+			*page &= ~PAGE_ACCESSED;
+			continue;
+		}
+		if (*page & PAGE_DIRTY) {
+			if (!victim)
+				victim = page;
+			continue;
+		}
+		if (try_to_swap_out(page)) {
+			swap_address[nr] = addr;
 			return 1;
+		}
 	}
-	printk("Out of swap-memory\n\r");
+	swap_address[nr] = (addr < TASK_SIZE) ? addr : 0;
+	invalidate();
+	return dirty && victim && try_to_swap_out(victim);
+}
+
+int swap_out(void)
+{
+	int dirty, i, nr;
+
+	for (i = 0 ; i < NR_AHEAD ; i++)
+		if (ahead[i]) {
+			drop_ahead(i);
+			return 1;
+		}
+	for (dirty = 0 ; dirty < 2 ; dirty++)
+		for (i = 1 ; i < NR_TASKS ; i++) {
+			nr = swap_task;
+			if (++swap_task >= NR_TASKS)
+				swap_task = 1;
+			if (task[nr] && swap_task_out(nr,dirty))
+				return 1;
+		}
 	return 0;
 }
 
+static void free_swap_map(struct swap_info_struct * p)
+{
+	int i;
+
+	if (!p->swap_map)
+		return;
+	for (i = 0 ; i < 1024 && p->swap_map[i] ; i++)
+		free_page((unsigned long) p->swap_map[i]);
+	free_page((unsigned long) p->swap_map);
+	p->swap_map = NULL;
+}
+
 /*
- * Get physical address of first (actually last :-) free page, and mark it
- * used. If no free pages left, return 0.
+ * Reads the header page of a new area, and sets up the counts: slots
+ * that can't be used are SWAP_MAP_BAD. The old header is a bitmap of
+ * the good pages, which can't describe more than 32k of them. The new
+ * one gives the size and a list of bad pages. Returns the number of
+ * good pages, or an error.
  */
-unsigned long get_free_page(void)
+static int read_swap_header(int type, int size)
 {
-	register unsigned long __res asm("ax");
-
-	do {
-		__asm__(
-			"std\n\t"
-			"repnz scasb\n\t"
-			"jne 1f\n\t"
-			"movb $1, 1(%%edi)\n\t"
-			"sal $12, %%ecx\n\t"
-			"add %2, %%ecx\n\t"
-			"mov %%ecx, %%edx\n\t"
-			"mov $1024, %%ecx\n\t"
-			"mov %%edx, %%edi\n\t"
-			"cld\n\t"
-			"rep stosl\n\t"
-			"mov %%edx,%%eax\n"
-			"1:"
-			: "=a" (__res)
-			: "0"(0), "i"(LOW_MEM), "c"(PAGING_PAGES), "D"(mem_map+PAGING_PAGES-1));
-	} while (__res >= HIGH_MEMORY || !__res&&swap_out());
-	return __res;
+	struct swap_info_struct * p = swap_info + type;
+	char * header;
+	unsigned long * info;
+	int i, n, good = 0;
+
+	if (!(header = (char *) get_free_page()))
+		return -ENOMEM;
+	rw_swap_page(READ,SWP_ENTRY(type,0),header);
+	info = (unsigned long *) (header + 1024);
+	if (!strncmp("SWAP-SPACE",header+PAGE_SIZE-10,10))
+		p->max = (PAGE_SIZE-10)*8;
+	else if (!strncmp("SWAPSPACE2",header+PAGE_SIZE-10,10) && info[0] == 1)
+		p->max = info[1]+1;	/* last_page */
+	else {
+		free_page((unsigned long) header);
+		return -EINVAL;
+	}
+	if (size && p->max > size)
+		p->max = size;
+	if (p->max > MAX_SWAP_PAGES)
+		p->max = MAX_SWAP_PAGES;
+	p->swap_map = NULL;
+	if (p->max < 2 || !(p->swap_map = (unsigned char **) get_free_page()))
+		goto out;
+	for (i = 0 ; i < (p->max+4095)>>12 ; i++)
+		if (!(p->swap_map[i] = (unsigned char *) get_free_page()))
+			goto out;
+	swap_count(p,0) = SWAP_MAP_BAD;
+	if (header[PAGE_SIZE-1] == '2') {
+		for (n = 0 ; n < info[2] && n < (PAGE_SIZE-10-1536)/4 ; n++)
+			if (info[128+n] && info[128+n] < p->max)
+				swap_count(p,info[128+n]) = SWAP_MAP_BAD;
+	} else
+		for (i = 1 ; i < p->max ; i++)
+			if (!(header[i>>3] & (1 << (i & 7))))
+				swap_count(p,i) = SWAP_MAP_BAD;
+/* a swap file can't have holes */
+	for (i = 1 ; i < p->max ; i++) {
+		if (p->file && !swap_count(p,i))
+			for (n = 0 ; n < 4 ; n++)
+				if (!p->file->i_op->bmap(p->file,(i<<2)+n))
+					swap_count(p,i) = SWAP_MAP_BAD;
+		if (!swap_count(p,i))
+			good++;
+	}
+out:
+	free_page((unsigned long) header);
+	if (good)
+		return good;
+	free_swap_map(p);
+	return p->swap_map ? -EINVAL : -ENOMEM;
 }
 
-void init_swapping(void)
+static void insert_swap(int type)
 {
-	extern int *blk_size[];
-	int swap_size,i,j;
+	struct swap_info_struct * p = swap_info + type;
+	int prev = -1, i;
 
-	if (!SWAP_DEV)
-		return;
-	if (!blk_size[MAJOR(SWAP_DEV)]) {
-		printk("Unable to get size of swap device\n\r");
+	for (i = swap_head ; i >= 0 ; prev = i, i = swap_info[i].next)
+		if (p->prio > swap_info[i].prio)
+			break;
+	p->next = i;
+	if (prev < 0)
+		swap_head = type;
+	else
+		swap_info[prev].next = type;
+	swap_next = swap_head;
+	p->flags = SWP_WRITEOK;
+}
+
+static void remove_swap(int type)
+{
+	int prev = -1, i;
+
+	for (i = swap_head ; i >= 0 ; prev = i, i = swap_info[i].next)
+		if (i == type)
+			break;
+	if (i < 0)
 		return;
+	if (prev < 0)
+		swap_head = swap_info[i].next;
+	else
+		swap_info[prev].next = swap_info[i].next;
+	swap_next = swap_head;
+	swap_info[type].flags = SWP_USED;
+}
+
+/*
+ * Adds the block device 'dev', or the regular file 'file' (whose
+ * reference we then keep) as a swap area.
+ */
+static int do_swapon(int dev, struct m_inode * file, int prio)
+{
+	extern int *blk_size[];
+	struct swap_info_struct * p;
+	int type, size = 0, good;
+
+	for (type = 0, p = swap_info ; type < MAX_SWAPFILES ; type++, p++)
+		if (p->flags && (dev ? p->dev == dev : p->file == file))
+			return -EBUSY;
+	for (type = 0, p = swap_info ; type < MAX_SWAPFILES ; type++, p++)
+		if (!p->flags)
+			break;
+	if (type >= MAX_SWAPFILES)
+		return -EPERM;
+	if (dev) {
+		if (blk_size[MAJOR(dev)])
+			size = blk_size[MAJOR(dev)][MINOR(dev)] >> 2;
+	} else
+		size = file->i_size >> 12;
+	p->dev = dev;
+	p->file = file;
+	p->flags = SWP_USED;
+	p->inuse = 0;
+	p->cluster_next = 1;
+	p->cluster_left = 0;
+	p->prio = prio;
+	if ((good = read_swap_header(type,size)) < 0) {
+		p->flags = 0;
+		return good;
 	}
-	swap_size = blk_size[MAJOR(SWAP_DEV)][MINOR(SWAP_DEV)];
-	if (!swap_size)
-		return;
-	if (swap_size < 100) {
-		printk("Swap device too small (%d blocks)\n\r",swap_size);
-		return;
+	insert_swap(type);
+	printk("Adding swap: %d pages (%d bytes) swap-space, priority %d\n\r",
+		good,good*4096,prio);
+	return 0;
+}
+
+int sys_swapon(const char * specialfile, int swap_flags)
+{
+	struct m_inode * inode;
+	int prio, error;
+
+	if (!suser())
+		return -EPERM;
+	if (!(inode = namei(specialfile)))
+		return -ENOENT;
+	if (swap_flags & SWAP_FLAG_PREFER)
+		prio = swap_flags & SWAP_FLAG_PRIO_MASK;
+	else
+		prio = --least_priority;
+	if (S_ISBLK(inode->i_mode)) {
+		error = do_swapon(inode->i_zone[0],NULL,prio);
+		iput(inode);
+		return error;
 	}
-	swap_size >>= 2;
-	if (swap_size > SWAP_BITS)
-		swap_size = SWAP_BITS;
-	swap_bitmap = (char *) get_free_page();
-	if (!swap_bitmap) {
-		printk("Unable to start swapping: out of memory :-)\n\r");
-		return;
+	if (!S_ISREG(inode->i_mode) || !inode->i_op || !inode->i_op->bmap)
+		error = -EINVAL;
+	else if (!(error = do_swapon(0,inode,prio)))
+		return 0;
+	iput(inode);
+	return error;
+}
+
+/*
+ * Brings in everything task 'nr' has in area 'type'. Returns the number
+ * of pages read, or -ENOMEM.
+ */
+static int unuse_task(int nr, int type)
+{
+	unsigned long addr, pg_table, * page, entry, new_page;
+	int count = 0;
+
+	for (addr = 0 ; addr < TASK_SIZE ; addr += PAGE_SIZE) {
+		pg_table = pg_dir[(nr*TASK_SIZE + addr) >> 22];
+		if (!(pg_table & 1)) {
+			addr |= 0x3ff000;
+			continue;
+		}
+		page = (unsigned long *) (pg_table & 0xfffff000);
+		page += (addr >> 12) & 0x3ff;
+		if (!*page || (*page & PAGE_PRESENT) ||
+		    SWP_TYPE(entry = *page >> 1) != type)
+			continue;
+		if (!(new_page = __get_free_page()))
+			return -ENOMEM;
+		rw_swap_page(READ,entry,(char *) new_page);
+		if (!task[nr] || pg_dir[(nr*TASK_SIZE + addr) >> 22] != pg_table ||
+		    *page != entry<<1) {		/* changed meanwhile */
+			free_page(new_page);
+			continue;
+		}
+		*page = new_page | (PAGE_DIRTY | 7);
+		swap_free(entry);
+		count++;
 	}
-	read_swap_page(0,swap_bitmap);
-	if (strncmp("SWAP-SPACE",swap_bitmap+4086,10)) {
-		printk("Unable to find swap-space signature\n\r");
-		free_page((long) swap_bitmap);
-		swap_bitmap = NULL;
-		return;
+	return count;
+}
+
+/*
+ * Pages in the swap cache don't get to keep their slots: from now on
+ * they have to be written out, so all their mappings are made dirty
+ * before the cache forgets them. None of this sleeps.
+ */
+static void unuse_cache(int type)
+{
+	unsigned long addr, pg_table, * page, nr;
+	int i;
+
+	for (i = 1 ; i < NR_TASKS ; i++) {
+		if (!task[i])
+			continue;
+		for (addr = i*TASK_SIZE ; addr < (i+1)*TASK_SIZE ; addr += PAGE_SIZE) {
+			pg_table = pg_dir[addr >> 22];
+			if (!(pg_table & 1)) {
+				addr |= 0x3ff000;
+				continue;
+			}
+			page = (unsigned long *) (pg_table & 0xfffff000);
+			page += (addr >> 12) & 0x3ff;
+			if (!(*page & PAGE_PRESENT) ||
+			    *page - LOW_MEM > PAGING_MEMORY)
+				continue;
+			nr = MAP_NR(*page & 0xfffff000);
+			if (swap_cache[nr] && SWP_TYPE(swap_cache[nr]) == type)
+				*page |= PAGE_DIRTY;
+		}
 	}
-	memset(swap_bitmap+4086,0,10);
-	for (i = 0 ; i < SWAP_BITS ; i++) {
-		if (i == 1)
-			i = swap_size;
-		if (bit(swap_bitmap,i)) {
-			printk("Bad swap-space bit-map\n\r");
-			free_page((long) swap_bitmap);
-			swap_bitmap = NULL;
-			return;
+	for (nr = 0 ; nr < PAGING_PAGES ; nr++)
+		if (swap_cache[nr] && SWP_TYPE(swap_cache[nr]) == type) {
+			swap_free(swap_cache[nr]);
+			swap_cache[nr] = 0;
+		}
+	for (i = 0 ; i < NR_AHEAD ; i++)
+		if (ahead[i] && SWP_TYPE(ahead_entry[i]) == type)
+			drop_ahead(i);
+	invalidate();
+}
+
+static int try_to_unuse(int type)
+{
+	struct swap_info_struct * p = swap_info + type;
+	int i, n, found;
+
+	while (p->inuse) {
+		found = 0;
+		for (i = 1 ; i < NR_TASKS ; i++) {
+			if (!task[i])
+				continue;
+			if ((n = unuse_task(i,type)) < 0)
+				return n;
+			found += n;
+		}
+		n = p->inuse;
+		unuse_cache(type);
+		if (!found && p->inuse == n && p->inuse) {
+			printk("swapoff: %d pages still in use\n\r",p->inuse);
+			return -EBUSY;
 		}
 	}
-	j = 0;
-	for (i = 1 ; i < swap_size ; i++)
-		if (bit(swap_bitmap,i))
-			j++;
-	if (!j) {
-		free_page((long) swap_bitmap);
-		swap_bitmap = NULL;
-		return;
+	return 0;
+}
+
+int sys_swapoff(const char * specialfile)
+{
+	struct swap_info_struct * p;
+	struct m_inode * inode;
+	int type, error;
+
+	if (!suser())
+		return -EPERM;
+	if (!(inode = namei(specialfile)))
+		return -ENOENT;
+	for (type = 0, p = swap_info ; type < MAX_SWAPFILES ; type++, p++)
+		if ((p->flags & SWP_WRITEOK) == SWP_WRITEOK &&
+		    (S_ISBLK(inode->i_mode) ? p->dev == inode->i_zone[0] :
+		     p->file == inode))
+			break;
+	iput(inode);
+	if (type >= MAX_SWAPFILES)
+		return -EINVAL;
+	remove_swap(type);
+	if (error = try_to_unuse(type)) {
+		insert_swap(type);
+		return error;
 	}
-	printk("Swap device ok: %d pages (%d bytes) swap-space\n\r",j,j*4096);
+	free_swap_map(p);
+	if (p->file)
+		iput(p->file);
+	p->file = NULL;
+	p->dev = 0;
+	p->flags = 0;
+	return 0;
+}
+
+/*
+ * The swap device the kernel was built with (or that 'build' wrote
+ * into the boot block) comes first.
+ */
+void init_swapping(void)
+{
+	if (SWAP_DEV)
+		do_swapon(SWAP_DEV,NULL,--least_priority);
 }
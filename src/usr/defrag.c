@@ -0,0 +1,51 @@
+/*
+ *  linux/usr/defrag.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * defrag file...
+ *
+ * The front end to defrag(): relocates each file into one contiguous
+ * run and says how many pieces it was in before and after. It runs on
+ * the system itself, so build it there: cc -o defrag defrag.c
+ */
+#define __LIBRARY__
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/* in case the libc doesn't have it yet */
+_syscall2(int,defrag,int,fd,struct defrag_stat *,stat)
+
+int main(int argc, char ** argv)
+{
+	struct defrag_stat st;
+	int i, fd, ret = 0;
+
+	if (argc < 2) {
+		fprintf(stderr,"usage: defrag file...\n");
+		return 1;
+	}
+	for (i = 1 ; i < argc ; i++) {
+		if ((fd = open(argv[i],O_RDONLY)) < 0) {
+			perror(argv[i]);
+			ret = 1;
+			continue;
+		}
+		if (defrag(fd,&st) < 0) {
+			if (errno == EBUSY)
+				fprintf(stderr,"%s: in use\n",argv[i]);
+			else
+				perror(argv[i]);
+			ret = 1;
+		} else
+			printf("%s: %ld blocks, %ld -> %ld pieces\n",argv[i],
+				st.d_blocks,st.d_before,st.d_after);
+		close(fd);
+	}
+	return ret;
+}